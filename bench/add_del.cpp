@@ -4,6 +4,7 @@
 // http://vittorioromeo.info | vittorio.romeo@outlook.com
 
 #include "./utils/dependencies.hpp"
+#include "./utils/disorder.hpp"
 
 namespace example
 {
@@ -14,6 +15,11 @@ namespace example
         {
             float _v;
             int _spawns;
+
+#ifdef EXAMPLE_DETERMINISTIC
+            // Seed of the entity's random stream.
+            std::uint32_t _seed;
+#endif
         };
     }
 }
@@ -28,7 +34,7 @@ EXAMPLE_SYSTEM_TAG(life);
 namespace example
 {
     template <typename TProxy>
-    void mk_particle(TProxy& proxy, int spawns);
+    void mk_particle(TProxy& proxy, int spawns, std::uint32_t seed);
 }
 
 using ft = float;
@@ -52,10 +58,20 @@ namespace example
                             data.kill_entity(eid);
                             if(spawns > 0)
                             {
+#ifdef EXAMPLE_DETERMINISTIC
+                                auto seed =
+                                    mix_seed(data.get(ct::life, eid)._seed);
+
+                                data.defer([spawns, seed](auto& proxy)
+                                    {
+                                        mk_particle(proxy, spawns - 1, seed);
+                                    });
+#else
                                 data.defer([spawns](auto& proxy)
                                     {
-                                        mk_particle(proxy, spawns - 1);
+                                        mk_particle(proxy, spawns - 1, 0);
                                     });
+#endif
                             }
                         }
                     });
@@ -110,26 +126,39 @@ namespace example
         }
     }
 
+    // Deferred functions run in an order depending on the threading policy,
+    // so in deterministic mode the life of a particle is derived from its
+    // seed instead of `rnd_gen`.
     template <typename TProxy>
-    void mk_particle(TProxy& proxy, int spawns)
+    void mk_particle(TProxy& proxy, int spawns, std::uint32_t seed)
     {
         auto eid = proxy.create_entity();
 
         auto& ccl = proxy.add_component(ct::life, eid);
+#ifdef EXAMPLE_DETERMINISTIC
+        ccl._v = seeded_rndf(seed, 2, 4);
+        ccl._seed = seed;
+#else
         ccl._v = rndf(2, 4);
+        (void)seed;
+#endif
         ccl._spawns = spawns;
     }
 
     template <typename TContext>
     void init_ctx(TContext& ctx)
     {
+        auto creation_begin = hrc::now();
+
         ctx.step([&](auto& proxy)
             {
                 for(sz_t i = 0; i < initial_particle_count; ++i)
                 {
-                    mk_particle(proxy, 300);
+                    mk_particle(proxy, 300, static_cast<std::uint32_t>(i));
                 }
             });
+
+        _recorder.creation(elapsed_ms(creation_begin));
     }
 
 
@@ -142,23 +171,35 @@ namespace example
 
 
 
-        ctx.step([&rt, dt](auto& proxy)
+        // The refresh stage runs right after the step function returns.
+        tp refresh_begin;
+
+        ctx.step([&rt, dt, &refresh_begin](auto& proxy)
             {
                 proxy.execute_systems()(
-                    sea::t(st::life).for_subtasks([dt](auto& s, auto& data)
-                        {
-                            s.process(dt, data);
-                        }));
+                    sea::t(st::life).detailed_instance(
+                        trace::instance([dt](auto& s, auto& data)
+                            {
+                                measure_disorder(data);
+                                s.process(dt, data);
+                            })));
+
+                refresh_begin = hrc::now();
             });
 
+        _recorder.refresh(elapsed_ms(refresh_begin));
+
+#ifdef EXAMPLE_MEASURE_DISORDER
+        _recorder.disorder(_disorder_counter.take());
+#endif
+
 
         ctx.step([&](auto& proxy)
             {
                 if(!proxy.any_entity_in(st::life))
                 {
                     // std::cout << "rng test:" << rndf(0, 100) << "\n";
-                    std::cout << initial_particle_count << ": ";
-                    example::bench();
+                    example::bench(initial_particle_count);
 
                     if(remaining_waves > 0)
                     {
@@ -176,7 +217,11 @@ namespace example
     }
 }
 
+#ifdef EXAMPLE_HEADLESS
+#include "./utils/headless_app.hpp"
+#else
 #include "./utils/pres_game_app.hpp"
+#endif
 
 namespace impl
 {
@@ -257,13 +302,20 @@ void run_tests(TF&& f, TEntityCount ec, TCSL csl, TSSL ssl)
     for(sz_t t = 0; t < times; ++t)
     {
         std::cout << "run " << t << "\n";
-        ecst::bh::for_each(impl::make_settings_list(ec, csl, ssl), [f](auto s)
+        auto settings_list = impl::make_settings_list(ec, csl, ssl);
+        ecst::bh::for_each(settings_list, [f, t](auto s)
             {
-                std::cout << ecst::settings::str::entity_storage<decltype(s)>()
-                          << "\n"
-                          << ecst::settings::str::multithreading<decltype(s)>()
-                          << "\n";
+                auto entity_storage =
+                    ecst::settings::str::entity_storage<decltype(s)>();
+
+                auto multithreading =
+                    ecst::settings::str::multithreading<decltype(s)>();
+
+                std::cout << entity_storage << "\n"
+                          << multithreading << "\n";
 
+                example::_recorder.begin_settings(
+                    std::string{entity_storage} + " | " + multithreading, t);
                 impl::do_test(s, f);
             });
     }
@@ -271,8 +323,11 @@ void run_tests(TF&& f, TEntityCount ec, TCSL csl, TSSL ssl)
     std::cout << "\n\n\n";
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    // Optional basename of the JSON/CSV result files.
+    std::string results_basename{argc > 1 ? argv[1] : ""};
+
     auto doit = [&](auto& ctx)
     {
         // Run the simulation.
@@ -285,4 +340,9 @@ int main()
 
     run_tests(doit, example::entity_limit, example::ecst_setup::make_csl(),
         example::ecst_setup::make_ssl());
+
+    if(!results_basename.empty())
+    {
+        example::_recorder.write_files(results_basename);
+    }
 }
\ No newline at end of file
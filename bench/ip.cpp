@@ -4,6 +4,12 @@
 // http://vittorioromeo.info | vittorio.romeo@outlook.com
 
 #include "./utils/dependencies.hpp"
+#include "./utils/conflict_batches.hpp"
+#include "./utils/grid_broadphase.hpp"
+#include "./utils/paged_storage.hpp"
+#include "./utils/parallel_for.hpp"
+#include "./utils/pipelined_outputs.hpp"
+#include "./utils/recycled_vector.hpp"
 
 namespace example
 {
@@ -30,21 +36,33 @@ namespace example
         }
     };
 
-    // Data for the assignment of an entity to a cell of the spatial
-    // partitioning grid.
-    struct sp_data
+    // Compact render record of a particle, meant for instanced drawing: the
+    // circle geometry is expanded from it by the GPU instead of by
+    // `render_colored_circle`.
+    struct circle_instance
     {
-        ecst::entity_id _e;
-        sz_t _cell_x, _cell_y;
+        vec2f _position;
+        float _radius;
 
-        sp_data(ecst::entity_id e, sz_t cell_x, sz_t cell_y) noexcept
-            : _e(e),
-              _cell_x(cell_x),
-              _cell_y(cell_y)
-        {
-        }
+        // Packed RGBA color.
+        std::uint32_t _color;
     };
 
+    // System output types. Their storage is recycled across steps, even when
+    // the number of subtasks changes.
+    using contact_buffer = recycled_vector<contact>;
+    using vertex_buffer = recycled_vector<sf::Vertex>;
+    using instance_buffer = recycled_vector<circle_instance>;
+
+    // Define `EXAMPLE_INSTANCED_RENDER` to make `render_colored_circle` output
+    // one `circle_instance` per particle instead of the vertices of its
+    // triangles.
+#ifdef EXAMPLE_INSTANCED_RENDER
+    using render_buffer = instance_buffer;
+#else
+    using render_buffer = vertex_buffer;
+#endif
+
     // Component definitions.
     namespace c
     {
@@ -93,6 +111,7 @@ EXAMPLE_SYSTEM_TAG(acceleration);
 EXAMPLE_SYSTEM_TAG(velocity);
 EXAMPLE_SYSTEM_TAG(keep_in_bounds);
 EXAMPLE_SYSTEM_TAG(spatial_partition);
+EXAMPLE_SYSTEM_TAG(grid_fill);
 EXAMPLE_SYSTEM_TAG(collision);
 EXAMPLE_SYSTEM_TAG(solve_contacts);
 EXAMPLE_SYSTEM_TAG(render_colored_circle);
@@ -101,6 +120,30 @@ EXAMPLE_SYSTEM_TAG(fade);
 
 namespace example
 {
+#ifdef EXAMPLE_PARALLEL_CONTACTS
+    // Define `EXAMPLE_PARALLEL_CONTACTS` to solve contacts in parallel, in
+    // batches of contacts not sharing any particle. Results are bit-identical
+    // to the serial solver, unless `EXAMPLE_PARALLEL_CONTACTS_GREEDY` is also
+    // defined, which uses fewer batches but changes the solving order.
+    //
+    // The pool is created on first use, so that no thread is started before
+    // `main`.
+    inline auto& contacts_pool()
+    {
+        static parallel_for_pool pool;
+        return pool;
+    }
+
+#ifdef EXAMPLE_PARALLEL_CONTACTS_GREEDY
+    constexpr bool contacts_preserve_order = false;
+#else
+    constexpr bool contacts_preserve_order = true;
+#endif
+
+    // Number of contacts claimed at once by a worker.
+    constexpr sz_t contacts_chunk_size = 256;
+#endif
+
     // System definitions.
     namespace s
     {
@@ -182,12 +225,13 @@ namespace example
         };
 
         // This system stores a spatial partitioning grid (to speed-up
-        // broadphase collision detection) and outputs a vector of `sp_data`,
-        // which is used in a later step to actually fill the spatial
-        // partitioning grid.
+        // broadphase collision detection) and counts the particles falling in
+        // every cell. The grid is then filled by `grid_fill`.
         struct spatial_partition
         {
-            // Partitioning constants.
+            // Partitioning constants. Cells must be at least as big as the
+            // largest particle diameter, so that every collision can be found
+            // in the neighbourhood of a particle's cell.
             static constexpr sz_t cell_size = 8;
             static constexpr sz_t offset = 2;
 
@@ -199,90 +243,79 @@ namespace example
 
             static constexpr sz_t cell_count = grid_width * grid_height;
 
-            // The grid is a simple 1D array of cells.
-            // A cell is a vector of entity IDs.
-            using cell_type = std::vector<ecst::entity_id>;
-            std::array<std::array<cell_type, grid_height>, grid_width> _grid;
+            // Every particle is stored only in the cell containing its
+            // center.
+            grid_broadphase<grid_width, grid_height> _grid;
 
             // Clear all cells from the particles.
             void clear_cells() noexcept
             {
-                for(auto& y : _grid)
-                {
-                    for(auto& c : y)
-                    {
-                        c.clear();
-                    }
-                }
+                _grid.clear();
             }
 
-            auto& cell_by_idxs(sz_t x, sz_t y) noexcept
+            // From world coordinates to cell index.
+            auto idx(float x, sz_t size) noexcept
             {
-                return _grid[x + offset][y + offset];
+                auto i = static_cast<long>(fFloor(x / cell_size)) +
+                         static_cast<long>(offset);
+                return static_cast<sz_t>(
+                    std::min(std::max(i, 0l), static_cast<long>(size) - 1));
             }
 
-            // Given an `sp_data`, emplaces an entity ID in a target cell.
-            void add_sp(const sp_data& x)
+            // Returns the index of the cell containing the position `p`.
+            auto cell_idx_by_pos(const vec2f& p) noexcept
             {
-                cell_by_idxs(x._cell_x, x._cell_y).emplace_back(x._e);
+                return _grid.cell_idx(
+                    idx(p.x, grid_width), idx(p.y, grid_height));
             }
 
-            // From world coordinates to cell index.
-            auto idx(float x) noexcept
+            // Executes `f` on every cell that can contain particles colliding
+            // with a particle at position `p`.
+            template <typename TF>
+            void for_cells_around(const vec2f& p, TF&& f)
             {
-                return x / cell_size;
+                _grid.for_neighbourhood(
+                    idx(p.x, grid_width), idx(p.y, grid_height), FWD(f));
             }
 
-            // Returns the cell containing the position `p`.
-            auto& cell_by_pos(const vec2f& p) noexcept
+            // Computes the cell offsets once all particles have been counted.
+            void prefix_sum()
             {
-                return cell_by_idxs(idx(p.x), idx(p.y));
+                _grid.prefix_sum();
             }
 
-            // Executes `f` on every cell contaning the circle described by `p`
-            // and `r`.
-            template <typename TF>
-            void for_cells_of(const vec2f& p, float r, TF&& f)
+            template <typename TData>
+            void process(TData& data)
             {
-                auto left = p.x - r;
-                auto right = p.x + r;
-                auto top = p.y - r;
-                auto bottom = p.y + r;
-
-                auto s_ix = fFloor(idx(left));
-                auto e_ix = fCeil(idx(right));
-                auto s_iy = fFloor(idx(top));
-                auto e_iy = fCeil(idx(bottom));
-
-                for(auto ix(s_ix); ix <= e_ix; ++ix)
-                {
-                    for(auto iy(s_iy); iy <= e_iy; ++iy)
+                // For every entity in the subtask...
+                data.for_entities([&](auto eid)
                     {
-                        f(ix, iy);
-                    }
-                }
+                        // Access component data.
+                        const auto& p = data.get(ct::position, eid)._v;
+
+                        // Figure out the broadphase cell and count the
+                        // particle in it.
+                        _grid.count(this->cell_idx_by_pos(p));
+                    });
             }
+        };
 
+        // This system scatters the subscribed particles into the cells of the
+        // spatial partitioning grid, after `spatial_partition` has counted
+        // them.
+        struct grid_fill
+        {
             template <typename TData>
             void process(TData& data)
             {
-                // Get a reference to the output vector and clear it.
-                auto& o = data.output();
-                o.clear();
+                // Get a reference to the `spatial_partition` system.
+                auto& sp = data.system(st::spatial_partition);
 
                 // For every entity in the subtask...
                 data.for_entities([&](auto eid)
                     {
-                        // Access component data.
                         const auto& p = data.get(ct::position, eid)._v;
-                        const auto& c = data.get(ct::circle, eid)._radius;
-
-                        // Figure out the broadphase cell and emplace an
-                        // `sp_data` instance in the output vector.
-                        this->for_cells_of(p, c, [eid, &o](auto cx, auto cy)
-                            {
-                                o.emplace_back(eid, cx, cy);
-                            });
+                        sp._grid.insert(sp.cell_idx_by_pos(p), eid);
                     });
             }
         };
@@ -308,24 +341,29 @@ namespace example
                         auto& p0 = data.get(ct::position, eid)._v;
                         const auto& r0 = data.get(ct::circle, eid)._radius;
 
-                        // Access the grid cell containing position `p0`.
-                        auto& cell = sp.cell_by_pos(p0);
-
-                        // For every unique entity ID pair...
-                        for_unique_pairs(cell, eid, [&](auto eid2)
+                        // For every grid cell around position `p0`...
+                        sp.for_cells_around(p0, [&](const auto& cell)
                             {
-                                // Access the second particle's component data.
-                                auto& p1 = data.get(ct::position, eid2)._v;
-                                const auto& r1 =
-                                    data.get(ct::circle, eid2)._radius;
-
-                                // Check for a circle-circle collision.
-                                auto sd = distance(p0, p1);
-                                if(sd <= r0 + r1)
-                                {
-                                    // Emplace a `contact` in the output.
-                                    out.emplace_back(eid, eid2, sd);
-                                }
+                                // For every unique entity ID pair...
+                                for_unique_pairs(cell, eid, [&](auto eid2)
+                                    {
+                                        // Access the second particle's
+                                        // component data.
+                                        auto& p1 =
+                                            data.get(ct::position, eid2)._v;
+
+                                        const auto& r1 =
+                                            data.get(ct::circle, eid2)._radius;
+
+                                        // Check for a circle-circle collision.
+                                        auto sd = distance(p0, p1);
+                                        if(sd <= r0 + r1)
+                                        {
+                                            // Emplace a `contact` in the
+                                            // output.
+                                            out.emplace_back(eid, eid2, sd);
+                                        }
+                                    });
                             });
                     });
             }
@@ -336,9 +374,108 @@ namespace example
         // bouncing.
         struct solve_contacts
         {
+#if defined(EXAMPLE_DETERMINISTIC) || defined(EXAMPLE_PARALLEL_CONTACTS)
+            // Contacts of all collision subtasks. In deterministic mode they
+            // are sorted by entity IDs, as their order would otherwise depend
+            // on the number of subtasks and on the order of the entities in
+            // the grid cells.
+            std::vector<contact> _gathered;
+#endif
+
+#ifdef EXAMPLE_PARALLEL_CONTACTS
+            // Batches of contacts not sharing any particle.
+            conflict_batches<contact> _batches;
+#endif
+
+            template <typename TData>
+            void solve(TData& data, const contact& x)
+            {
+                // Access the first particle's data.
+                auto& p0 = data.get(ct::position, x._e0)._v;
+                auto& v0 = data.get(ct::velocity, x._e0)._v;
+                const auto& r0 = data.get(ct::circle, x._e0)._radius;
+
+                // Access the second particle's data.
+                auto& p1 = data.get(ct::position, x._e1)._v;
+                auto& v1 = data.get(ct::velocity, x._e1)._v;
+                const auto& r1 = data.get(ct::circle, x._e1)._radius;
+
+                // Solve.
+                solve_penetration(x._dist, p0, v0, r0, p1, v1, r1);
+            }
+
+#if defined(EXAMPLE_DETERMINISTIC) || defined(EXAMPLE_PARALLEL_CONTACTS)
+            template <typename TData>
+            void gather(TData& data)
+            {
+                _gathered.clear();
+
+                data.for_previous_outputs(st::collision,
+                    [this](auto&, const auto& out)
+                    {
+                        _gathered.insert(
+                            _gathered.end(), out.begin(), out.end());
+                    });
+
+#ifdef EXAMPLE_DETERMINISTIC
+                std::sort(_gathered.begin(), _gathered.end(),
+                    [](const auto& a, const auto& b)
+                    {
+                        return a._e0 < b._e0 ||
+                               (a._e0 == b._e0 && a._e1 < b._e1);
+                    });
+#endif
+            }
+#endif
+
+#ifdef EXAMPLE_PARALLEL_CONTACTS
+            // Solves the batches in sequence, and the contacts of every batch
+            // in parallel.
+            template <typename TData>
+            void process_batches(TData& data)
+            {
+                _batches.build(_gathered, contacts_preserve_order);
+
+                for(sz_t b = 0; b < _batches.batch_count(); ++b)
+                {
+                    auto batch = _batches.batch(b);
+
+                    if(_batches.serial(b))
+                    {
+                        for(const auto& x : batch)
+                        {
+                            solve(data, x);
+                        }
+
+                        continue;
+                    }
+
+                    contacts_pool().run(batch.size(), contacts_chunk_size,
+                        [this, &data, &batch](sz_t begin, sz_t end)
+                        {
+                            for(auto i = begin; i < end; ++i)
+                            {
+                                solve(data, batch[i]);
+                            }
+                        });
+                }
+            }
+#endif
+
             template <typename TData>
             void process(TData& data)
             {
+#if defined(EXAMPLE_PARALLEL_CONTACTS)
+                gather(data);
+                process_batches(data);
+#elif defined(EXAMPLE_DETERMINISTIC)
+                gather(data);
+
+                for(const auto& x : _gathered)
+                {
+                    solve(data, x);
+                }
+#else
                 // For every output produced by the collision detection
                 // system...
                 data.for_previous_outputs(st::collision,
@@ -346,22 +483,10 @@ namespace example
                     {
                         for(const auto& x : out)
                         {
-                            // Access the first particle's data.
-                            auto& p0 = data.get(ct::position, x._e0)._v;
-                            auto& v0 = data.get(ct::velocity, x._e0)._v;
-                            const auto& r0 =
-                                data.get(ct::circle, x._e0)._radius;
-
-                            // Access the second particle's data.
-                            auto& p1 = data.get(ct::position, x._e1)._v;
-                            auto& v1 = data.get(ct::velocity, x._e1)._v;
-                            const auto& r1 =
-                                data.get(ct::circle, x._e1)._radius;
-
-                            // Solve.
-                            solve_penetration(x._dist, p0, v0, r0, p1, v1, r1);
+                            solve(data, x);
                         }
                     });
+#endif
             }
         };
 
@@ -372,46 +497,82 @@ namespace example
             static constexpr float tau = 6.28f;
             static constexpr sz_t precision = 5;
             static constexpr float inc = tau / precision;
+            static constexpr sz_t vertices_per_entity = precision * 3;
+
+            // Emplaces the `vertices_per_entity` vertices of a circle in
+            // `va`.
+            template <typename TVertexArray>
+            static void mk_circle(TVertexArray& va, const vec2f& p0,
+                const sf::Color& c, float radius)
+            {
+                // Function to create and emplace 3 vertices.
+                auto mk_triangle = [&va, &p0, &c, &radius](auto a0, auto a1)
+                {
+                    auto a0cos = radius * tbl_cos(a0);
+                    auto a0sin = radius * tbl_sin(a0);
+                    auto a1cos = radius * tbl_cos(a1);
+                    auto a1sin = radius * tbl_sin(a1);
+
+                    vec2f p1(a0cos + p0.x, a0sin + p0.y);
+                    vec2f p2(a1cos + p0.x, a1sin + p0.y);
+
+                    va.emplace_back(p0, c);
+                    va.emplace_back(p1, c);
+                    va.emplace_back(p2, c);
+                };
 
+                // Build a circle.
+                for(sz_t i = 0; i < precision; ++i)
+                {
+                    mk_triangle(inc * i, inc * (i + 1));
+                }
+            }
+
+#ifdef EXAMPLE_INSTANCED_RENDER
             template <typename TData>
             void process(TData& data)
             {
-                // Get a reference to the output vector, and clear it.
-                auto& va = data.output();
-                va.clear();
+                // Get a reference to the output vector, and clear it. Every
+                // entity produces a single instance.
+                auto& out = data.output();
+                out.clear();
+                out.reserve(data.entity_count());
 
                 // For every entity in the subtask...
-                data.for_entities([this, &data, &va](auto eid)
+                data.for_entities([&data, &out](auto eid)
                     {
                         // Access the component data.
                         const auto& p0 = data.get(ct::position, eid)._v;
                         const auto& c = data.get(ct::color, eid)._v;
-                        auto& radius = data.get(ct::circle, eid)._radius;
-
-                        // Function to create and emplace 3 vertices.
-                        auto mk_triangle = [&va, &data, &p0, &c, &radius](
-                            auto a0, auto a1)
-                        {
-                            auto a0cos = radius * tbl_cos(a0);
-                            auto a0sin = radius * tbl_sin(a0);
-                            auto a1cos = radius * tbl_cos(a1);
-                            auto a1sin = radius * tbl_sin(a1);
+                        const auto& radius = data.get(ct::circle, eid)._radius;
 
-                            vec2f p1(a0cos + p0.x, a0sin + p0.y);
-                            vec2f p2(a1cos + p0.x, a1sin + p0.y);
+                        out.emplace_back(
+                            circle_instance{p0, radius, c.toInteger()});
+                    });
+            }
+#else
+            template <typename TData>
+            void process(TData& data)
+            {
+                // Get a reference to the output vector, and clear it. Every
+                // entity produces the same number of vertices, so the output
+                // can be reserved exactly.
+                auto& va = data.output();
+                va.clear();
+                va.reserve(data.entity_count() * vertices_per_entity);
 
-                            va.emplace_back(p0, c);
-                            va.emplace_back(p1, c);
-                            va.emplace_back(p2, c);
-                        };
+                // For every entity in the subtask...
+                data.for_entities([&data, &va](auto eid)
+                    {
+                        // Access the component data.
+                        const auto& p0 = data.get(ct::position, eid)._v;
+                        const auto& c = data.get(ct::color, eid)._v;
+                        const auto& radius = data.get(ct::circle, eid)._radius;
 
-                        // Build a circle.
-                        for(sz_t i = 0; i < precision; ++i)
-                        {
-                            mk_triangle(inc * i, inc * (i + 1));
-                        }
+                        mk_circle(va, p0, c, radius);
                     });
             }
+#endif
         };
 
         // This system slowly kills particles.
@@ -459,30 +620,57 @@ namespace example
 
     namespace ecst_setup
     {
+        // Component storage choices, applied to every component signature
+        // by `make_csl`.
+        struct contiguous_storage
+        {
+            static constexpr const char* name = "contiguous buffer";
+
+            template <typename TSignature>
+            constexpr auto operator()(TSignature x) const
+            {
+                return x.contiguous_buffer();
+            }
+        };
+
+        struct paged_storage
+        {
+            static constexpr const char* name = "paged buffer";
+
+            template <typename TSignature>
+            constexpr auto operator()(TSignature x) const
+            {
+                return x.storage_strategy(storage::paged_buffer_maker<>{});
+            }
+        };
+
         // Builds and returns a "component signature list".
-        constexpr auto make_csl()
+        template <typename TStorage>
+        constexpr auto make_csl(TStorage)
         {
             namespace cs = ecst::signature::component;
             namespace csl = ecst::signature_list::component;
 
+            constexpr TStorage storage{};
+
             // Store `c::acceleration`, `c::velocity`, `c::position` and
-            // `c::life`, in three separate contiguous buffers (SoA).
+            // `c::life`, in four separate buffers (SoA).
             constexpr auto cs_acceleration = // .
-                cs::make(ct::acceleration).contiguous_buffer();
+                storage(cs::make(ct::acceleration));
 
             constexpr auto cs_velocity = // .
-                cs::make(ct::velocity).contiguous_buffer();
+                storage(cs::make(ct::velocity));
 
             constexpr auto cs_position = // .
-                cs::make(ct::position).contiguous_buffer();
+                storage(cs::make(ct::position));
 
             constexpr auto cs_life = // .
-                cs::make(ct::life).contiguous_buffer();
+                storage(cs::make(ct::life));
 
-            // Store `c::color` and `c::circle` in the same contiguous buffer,
+            // Store `c::color` and `c::circle` in the same buffer,
             // interleaved (AoS).
             constexpr auto cs_rendering = // .
-                cs::make(ct::color, ct::circle).contiguous_buffer();
+                storage(cs::make(ct::color, ct::circle));
 
             return csl::make(    // .
                 cs_acceleration, // .
@@ -537,24 +725,31 @@ namespace example
 
             // Spatial partition system.
             // * Multithreaded.
-            // * Output: `std::vector<sp_data>`.
-            constexpr auto ss_spatial_partition =              // .
-                ss::make(st::spatial_partition)                // .
-                    .parallelism(split_evenly_per_core)        // .
-                    .dependencies(st::keep_in_bounds)          // .
-                    .read(ct::position, ct::circle)            // .
-                    .output(ss::output<std::vector<sp_data>>); // .
+            constexpr auto ss_spatial_partition =       // .
+                ss::make(st::spatial_partition)         // .
+                    .parallelism(split_evenly_per_core) // .
+                    .dependencies(st::keep_in_bounds)   // .
+                    .read(ct::position, ct::circle);    // .
+
+            // Grid fill system.
+            // * Multithreaded.
+            // * Subscribes to the same entities as `spatial_partition`.
+            constexpr auto ss_grid_fill =                // .
+                ss::make(st::grid_fill)                  // .
+                    .parallelism(split_evenly_per_core)  // .
+                    .dependencies(st::spatial_partition) // .
+                    .read(ct::position, ct::circle);     // .
 
             // Collision detection system.
             // * Multithreaded.
-            // * Output: `std::vector<contact>`.
-            constexpr auto ss_collision =                      // .
-                ss::make(st::collision)                        // .
-                    .parallelism(split_evenly_per_core)        // .
-                    .dependencies(st::spatial_partition)       // .
-                    .read(ct::circle)                          // .
-                    .write(ct::position, ct::velocity)         // .
-                    .output(ss::output<std::vector<contact>>); // .
+            // * Output: `contact_buffer`.
+            constexpr auto ss_collision =                // .
+                ss::make(st::collision)                  // .
+                    .parallelism(split_evenly_per_core)  // .
+                    .dependencies(st::grid_fill)         // .
+                    .read(ct::circle)                    // .
+                    .write(ct::position, ct::velocity)   // .
+                    .output(ss::output<contact_buffer>); // .
 
             // Solve contacts system.
             // * Singlethreaded.
@@ -567,16 +762,18 @@ namespace example
 
             // Render colored circle system.
             // * Multithreaded.
-            // * Output: `std::vector<sf::Vertex>`.
-            constexpr auto ss_render_colored_circle =             // .
-                ss::make(st::render_colored_circle)               // .
-                    .parallelism(split_evenly_per_core)           // .
-                    .dependencies(st::solve_contacts)             // .
-                    .read(ct::circle, ct::position, ct::color)    // .
-                    .output(ss::output<std::vector<sf::Vertex>>); // .
+            // * Reads `c::color`, written by `fade`.
+            // * Output: `render_buffer`.
+            constexpr auto ss_render_colored_circle =           // .
+                ss::make(st::render_colored_circle)             // .
+                    .parallelism(split_evenly_per_core)         // .
+                    .dependencies(st::solve_contacts, st::fade) // .
+                    .read(ct::circle, ct::position, ct::color)  // .
+                    .output(ss::output<render_buffer>);         // .
 
             // Life system.
             // * Multithreaded.
+            // * No dependencies.
             constexpr auto ss_life =                    // .
                 ss::make(st::life)                      // .
                     .parallelism(split_evenly_per_core) // .
@@ -584,9 +781,11 @@ namespace example
 
             // Fade system.
             // * Multithreaded.
+            // * Reads `c::life`, written by `life`.
             constexpr auto ss_fade =                    // .
                 ss::make(st::fade)                      // .
                     .parallelism(split_evenly_per_core) // .
+                    .dependencies(st::life)             // .
                     .read(ct::life)                     // .
                     .write(ct::color);                  // .
 
@@ -596,6 +795,7 @@ namespace example
                 ss_velocity,              // .
                 ss_keep_in_bounds,        // .
                 ss_spatial_partition,     // .
+                ss_grid_fill,             // .
                 ss_collision,             // .
                 ss_solve_contacts,        // .
                 ss_render_colored_circle, // .
@@ -641,76 +841,198 @@ namespace example
                 rndf(top_bound, bottom_bound)};
         };
 
+#ifdef EXAMPLE_CLUSTERED_SPAWN
+        // The first `cluster_fraction` of the created particles is packed in a
+        // small area near the bottom bound. As entity IDs follow creation
+        // order, the first inner parallelism slices get most of the crowded
+        // grid cells, and take much longer than the others.
+        constexpr float cluster_fraction = 0.25f;
+
+        auto clustered_position = []
+        {
+            constexpr float cluster_half_size = 60.f;
+            constexpr float center_x = (right_bound - left_bound) / 4.f;
+            constexpr float center_y = bottom_bound - cluster_half_size;
+
+            return vec2f{
+                rndf(center_x - cluster_half_size,
+                    center_x + cluster_half_size),
+                rndf(center_y - cluster_half_size,
+                    center_y + cluster_half_size)};
+        };
+
+        const auto clustered_count =
+            static_cast<sz_t>(initial_particle_count * cluster_fraction);
+#endif
+
+        auto creation_begin = hrc::now();
+
         ctx.step([&](auto& proxy)
             {
                 for(sz_t i = 0; i < initial_particle_count; ++i)
                 {
+#ifdef EXAMPLE_CLUSTERED_SPAWN
+                    if(i < clustered_count)
+                    {
+                        mk_particle(
+                            proxy, clustered_position(), rndf(0.5, 2.5));
+
+                        continue;
+                    }
+#endif
+
                     mk_particle(proxy, random_position(), rndf(0.5, 2.5));
                 }
             });
+
+        _recorder.creation(elapsed_ms(creation_begin));
     }
 
     std::size_t remaining_waves = 2;
 
+    template <typename TRenderTarget>
+    void draw_output(TRenderTarget& rt, const vertex_buffer& va)
+    {
+        trace::span draw{"draw", "render"};
+
+#if 1
+        rt.draw(va.data(), va.size(), sf::PrimitiveType::Triangles,
+            sf::RenderStates::Default);
+#endif
+    }
+
+    // SFML does not support instanced drawing: on SFML render targets, the
+    // instances are expanded to triangles here, outside of the systems.
+    inline void draw_instances(sf::RenderTarget& rt, const instance_buffer& ib)
+    {
+        using circle_system = s::render_colored_circle;
+
+        static std::vector<sf::Vertex> va;
+        va.clear();
+        va.reserve(ib.size() * circle_system::vertices_per_entity);
+
+        for(const auto& x : ib)
+        {
+            circle_system::mk_circle(
+                va, x._position, sf::Color{x._color}, x._radius);
+        }
+
+        rt.draw(va.data(), va.size(), sf::PrimitiveType::Triangles,
+            sf::RenderStates::Default);
+    }
+
+    // Render targets supporting instanced drawing.
+    template <typename TRenderTarget>
+    auto draw_instances(TRenderTarget& rt, const instance_buffer& ib)
+        -> decltype(rt.draw_instances(ib.data(), ib.size()))
+    {
+        rt.draw_instances(ib.data(), ib.size());
+    }
+
+    template <typename TRenderTarget>
+    void draw_output(TRenderTarget& rt, const instance_buffer& ib)
+    {
+        trace::span draw{"draw", "render"};
+        draw_instances(rt, ib);
+    }
+
+#ifdef EXAMPLE_PIPELINED_RENDER
+    // Define `EXAMPLE_PIPELINED_RENDER` to draw the render outputs of frame `N`
+    // while frame `N + 1` is being stepped, instead of drawing them at the end
+    // of the step. Rendering lags one frame behind the simulation.
+    std::unique_ptr<pipelined_outputs<render_buffer>> _render_pipeline;
+#endif
+
+    // Runs `f` with a new render pipeline, destroyed when `f` returns, so
+    // that its thread only lives during the simulation and the last outputs
+    // of a context are never drawn by the next one.
+    template <typename TF>
+    void with_render_pipeline(TF&& f)
+    {
+#ifdef EXAMPLE_PIPELINED_RENDER
+        _render_pipeline =
+            std::make_unique<pipelined_outputs<render_buffer>>();
+
+        f();
+        _render_pipeline.reset();
+#else
+        f();
+#endif
+    }
+
     template <typename TContext, typename TRenderTarget>
-    void update_ctx(TContext& ctx, TRenderTarget& rt, ft dt)
+    void step_ctx(TContext& ctx, TRenderTarget& rt, ft dt)
     {
         namespace sea = ::ecst::system_execution_adapter;
 
         auto ft_tags = sea::t(st::acceleration, st::velocity, st::life);
-        auto nonft_tags = sea::t(st::keep_in_bounds, st::collision,
-            st::solve_contacts, st::render_colored_circle, st::fade);
+        auto nonft_tags = sea::t(st::keep_in_bounds, st::grid_fill,
+            st::collision, st::solve_contacts, st::render_colored_circle,
+            st::fade);
 
-        ctx.step([&rt, dt, &ft_tags, &nonft_tags](auto& proxy)
+        // The refresh stage runs right after the step function returns.
+        tp refresh_begin;
+
+        ctx.step([&rt, dt, &ft_tags, &nonft_tags, &refresh_begin](auto& proxy)
             {
                 proxy.execute_systems()(
-                    ft_tags.for_subtasks([dt](auto& s, auto& data)
-                        {
-                            s.process(dt, data);
-                        }),
-                    nonft_tags.for_subtasks([](auto& s, auto& data)
-                        {
-                            s.process(data);
-                        }),
+                    ft_tags.detailed_instance(
+                        trace::instance([dt](auto& s, auto& data)
+                            {
+                                s.process(dt, data);
+                            })),
+                    nonft_tags.detailed_instance(
+                        trace::instance([](auto& s, auto& data)
+                            {
+                                s.process(data);
+                            })),
                     sea::t(st::spatial_partition)
                         .detailed_instance([&proxy](auto& i, auto& executor)
                             {
+                                trace::span sys{"spatial_partition", "system"};
+
                                 auto& s(i.system());
-                                s.clear_cells();
+
+                                {
+                                    trace::span clear{"clear_cells", "phase"};
+                                    s.clear_cells();
+                                }
 
                                 executor.for_subtasks([&s](auto& data)
                                     {
+                                        trace::span sub{"spatial_partition",
+                                            "subtask", data.entity_count()};
+
                                         s.process(data);
                                     });
 
-                                i.for_outputs([](auto& xs, auto& sp_vector)
-                                    {
-                                        for(const auto& x : sp_vector)
-                                        {
-                                            xs.add_sp(x);
-                                        }
-                                    });
+                                trace::span prefix{"prefix_sum", "phase"};
+                                s.prefix_sum();
                             }));
 
                 proxy.for_system_outputs(st::render_colored_circle,
                     [&rt](auto&, auto& va)
                     {
-#if 1
-                        rt.draw(va.data(), va.size(),
-                            sf::PrimitiveType::Triangles,
-                            sf::RenderStates::Default);
+#ifdef EXAMPLE_PIPELINED_RENDER
+                        (void)rt;
+                        _render_pipeline->push(va);
+#else
+                        draw_output(rt, va);
 #endif
                     });
+
+                refresh_begin = hrc::now();
             });
 
+        _recorder.refresh(elapsed_ms(refresh_begin));
+
         ctx.step([&](auto& proxy)
             {
                 if(!proxy.any_entity_in(st::acceleration))
                 {
                     if(remaining_waves > 0)
                     {
-                        std::cout << initial_particle_count << ": ";
-                        example::bench();
+                        example::bench(initial_particle_count);
 
                         --remaining_waves;
                         initial_particle_count *= 2;
@@ -719,16 +1041,37 @@ namespace example
                     }
                     else
                     {
-                        std::cout << initial_particle_count << ": ";
-                        example::bench();
+                        example::bench(initial_particle_count);
                         example::_running = false;
                     }
                 }
             });
     }
+
+    template <typename TContext, typename TRenderTarget>
+    void update_ctx(TContext& ctx, TRenderTarget& rt, ft dt)
+    {
+#ifdef EXAMPLE_PIPELINED_RENDER
+        _render_pipeline->run(
+            [&ctx, &rt, dt]
+            {
+                step_ctx(ctx, rt, dt);
+            },
+            [&rt](const auto& va)
+            {
+                draw_output(rt, va);
+            });
+#else
+        step_ctx(ctx, rt, dt);
+#endif
+    }
 }
 
+#ifdef EXAMPLE_HEADLESS
+#include "./utils/headless_app.hpp"
+#else
 #include "./utils/pres_game_app.hpp"
+#endif
 
 namespace impl
 {
@@ -797,7 +1140,8 @@ namespace impl
 }
 
 template <typename TF, typename TEntityCount, typename TCSL, typename TSSL>
-void run_tests(TF&& f, TEntityCount ec, TCSL csl, TSSL ssl)
+void run_tests(TF&& f, TEntityCount ec, TCSL csl, TSSL ssl,
+    const char* component_storage)
 {
     using vrm::core::sz_t;
     constexpr sz_t times = 1;
@@ -809,13 +1153,24 @@ void run_tests(TF&& f, TEntityCount ec, TCSL csl, TSSL ssl)
     for(sz_t t = 0; t < times; ++t)
     {
         std::cout << "run " << t << "\n";
-        ecst::bh::for_each(impl::make_settings_list(ec, csl, ssl), [f](auto s)
+        auto settings_list = impl::make_settings_list(ec, csl, ssl);
+        ecst::bh::for_each(settings_list, [f, t, component_storage](auto s)
             {
-                std::cout << ecst::settings::str::entity_storage<decltype(s)>()
-                          << "\n"
-                          << ecst::settings::str::multithreading<decltype(s)>()
-                          << "\n";
+                auto entity_storage =
+                    ecst::settings::str::entity_storage<decltype(s)>();
+
+                auto multithreading =
+                    ecst::settings::str::multithreading<decltype(s)>();
+
+                std::cout << entity_storage << "\n"
+                          << component_storage << "\n"
+                          << multithreading << "\n";
+
+                auto settings_name = std::string{entity_storage} + " | " +
+                                     component_storage + " | " +
+                                     multithreading;
 
+                example::_recorder.begin_settings(settings_name, t);
                 impl::do_test(s, f);
             });
     }
@@ -823,8 +1178,11 @@ void run_tests(TF&& f, TEntityCount ec, TCSL csl, TSSL ssl)
     std::cout << "\n\n\n";
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    // Optional basename of the JSON/CSV result files.
+    std::string results_basename{argc > 1 ? argv[1] : ""};
+
     auto doit = [&](auto& ctx)
     {
         // Run the simulation.
@@ -832,9 +1190,25 @@ int main()
         example::_running = true;
         example::remaining_waves = 2;
         example::reseed();
-        example::run_simulation(ctx);
+        example::with_render_pipeline([&ctx]
+            {
+                example::run_simulation(ctx);
+            });
     };
 
-    run_tests(doit, example::entity_limit, example::ecst_setup::make_csl(),
-        example::ecst_setup::make_ssl());
+    // Run every setting with contiguous and paged component storage.
+    auto run_with_storage = [&](auto storage)
+    {
+        run_tests(doit, example::entity_limit,
+            example::ecst_setup::make_csl(storage),
+            example::ecst_setup::make_ssl(), decltype(storage)::name);
+    };
+
+    run_with_storage(example::ecst_setup::contiguous_storage{});
+    run_with_storage(example::ecst_setup::paged_storage{});
+
+    if(!results_basename.empty())
+    {
+        example::_recorder.write_files(results_basename);
+    }
 }
\ No newline at end of file
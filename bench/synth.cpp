@@ -0,0 +1,642 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+// Parametric synthetic benchmark. Systems are arranged in `width`
+// independent chains (lanes) of `depth` systems each: every lane has its own
+// component, and every system depends on the previous system of its lane.
+// A `churn` system kills a fixed fraction of the entities every step and
+// replaces them through deferred functions, so the entity count stays
+// constant. A small fraction of the entities also has a `sparse` component,
+// updated by its own system, and every setting is run with each storage
+// strategy for sparse components.
+//
+// Compile-time axes (macros):
+// * `EXAMPLE_SYNTH_WIDTH`: number of lanes and lane components (DAG width).
+// * `EXAMPLE_SYNTH_DEPTH`: number of systems per lane (DAG depth).
+// * `EXAMPLE_SYNTH_PARALLEL_THRESHOLD`: subscriber count below which systems
+//   run in a single subtask.
+//
+// Run-time axes (command line, in order):
+// * basename of the JSON/CSV result files;
+// * comma-separated entity counts of the waves (e.g. `1000,1000000`);
+// * per-entity cost, in iterations of the work kernel;
+// * churn rate, in percent of entities killed and created per step;
+// * number of steps per wave;
+// * sparse rate, in percent of entities having the `sparse` component.
+//
+// ECST sizes its worker pool and the subtasks of `split_evenly_fn::v_cores()`
+// from `std::thread::hardware_concurrency()`. Restricting the process' CPUs
+// (e.g. with `taskset`) only changes the cores the workers run on, not the
+// number of workers or subtasks. Both the CPU count allowed by the affinity
+// mask and the hardware thread count are part of the settings name.
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "./utils/dependencies.hpp"
+#include "./utils/sparse_storage.hpp"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#ifndef EXAMPLE_SYNTH_WIDTH
+#define EXAMPLE_SYNTH_WIDTH 4
+#endif
+
+#ifndef EXAMPLE_SYNTH_DEPTH
+#define EXAMPLE_SYNTH_DEPTH 3
+#endif
+
+#ifndef EXAMPLE_SYNTH_PARALLEL_THRESHOLD
+#define EXAMPLE_SYNTH_PARALLEL_THRESHOLD 0
+#endif
+
+namespace example
+{
+    constexpr sz_t synth_width = EXAMPLE_SYNTH_WIDTH;
+    constexpr sz_t synth_depth = EXAMPLE_SYNTH_DEPTH;
+    constexpr sz_t synth_system_count = synth_width * synth_depth;
+
+    // Component definitions.
+    namespace c
+    {
+        // Component of the `TLane`-th lane.
+        template <sz_t TLane>
+        struct lane
+        {
+            float _v;
+        };
+
+        // Seed of the entity's random stream, deciding when it is killed.
+        struct seed
+        {
+            std::uint32_t _v;
+        };
+
+        // Component of a small fraction of the entities.
+        struct sparse
+        {
+            float _v;
+        };
+    }
+
+    // System definitions, tags below.
+    namespace s
+    {
+        template <sz_t TIdx>
+        struct work;
+    }
+
+    // Component tags for the lane components, in namespace `example::ct`.
+    namespace ct
+    {
+        template <sz_t TLane>
+        constexpr auto lane = ecst::tag::component::v<c::lane<TLane>>;
+    }
+
+    // System tags for the work systems, in namespace `example::st`.
+    namespace st
+    {
+        template <sz_t TIdx>
+        constexpr auto work = ecst::tag::system::v<s::work<TIdx>>;
+    }
+
+    // Work systems are named `work_<index>` in traces.
+    namespace trace
+    {
+        template <sz_t TIdx>
+        struct system_name<s::work<TIdx>>
+        {
+            static const char* get() noexcept
+            {
+                static const auto name = "work_" + std::to_string(TIdx);
+                return name.c_str();
+            }
+        };
+    }
+}
+
+// Component tags, in namespace `example::ct`.
+EXAMPLE_COMPONENT_TAG(seed);
+EXAMPLE_COMPONENT_TAG(sparse);
+
+// System tags, in namespace `example::st`.
+EXAMPLE_SYSTEM_TAG(churn);
+EXAMPLE_SYSTEM_TAG(sparse_work);
+
+namespace example
+{
+    template <typename TProxy>
+    void mk_entity(TProxy& proxy, std::uint32_t seed);
+
+    // Run-time parameters.
+    sz_t per_entity_cost = 1;
+    std::uint32_t churn_per_10k = 0;
+    std::uint32_t sparse_per_10k = 100;
+    sz_t steps_per_wave = 200;
+
+    namespace s
+    {
+        // Runs `per_entity_cost` iterations of a dependent multiply-add on
+        // the component of its lane.
+        template <sz_t TIdx>
+        struct work
+        {
+            static constexpr sz_t lane_idx = TIdx % synth_width;
+
+            template <typename TData>
+            void process(TData& data)
+            {
+                data.for_entities([&](auto eid)
+                    {
+                        auto& v = data.get(ct::lane<lane_idx>, eid)._v;
+
+                        for(sz_t i = 0; i < per_entity_cost; ++i)
+                        {
+                            v = v * 0.999f + 1.f;
+                        }
+                    });
+            }
+        };
+
+        // Runs `per_entity_cost` iterations of the work kernel on the
+        // `sparse` component.
+        struct sparse_work
+        {
+            template <typename TData>
+            void process(TData& data)
+            {
+                data.for_entities([&](auto eid)
+                    {
+                        auto& v = data.get(ct::sparse, eid)._v;
+
+                        for(sz_t i = 0; i < per_entity_cost; ++i)
+                        {
+                            v = v * 0.999f + 1.f;
+                        }
+                    });
+            }
+        };
+
+        // Kills about `churn_per_10k` entities out of 10000 every step, and
+        // creates as many.
+        struct churn
+        {
+            template <typename TData>
+            void process(TData& data)
+            {
+                data.for_entities([&](auto eid)
+                    {
+                        auto& seed = data.get(ct::seed, eid)._v;
+                        seed = mix_seed(seed);
+
+                        if(seed % 10000 >= churn_per_10k)
+                        {
+                            return;
+                        }
+
+                        data.kill_entity(eid);
+
+                        auto child_seed = mix_seed(seed ^ 0x9e3779b9U);
+                        data.defer([child_seed](auto& proxy)
+                            {
+                                mk_entity(proxy, child_seed);
+                            });
+                    });
+            }
+        };
+    }
+
+    // Run-time entity counts of the waves.
+    std::vector<sz_t> wave_entity_counts{1000, 10000, 100000};
+
+    namespace ecst_setup
+    {
+        // Storage choices for the `sparse` component, applied by `make_csl`.
+        struct hash_map_storage
+        {
+            static constexpr const char* name = "hash map";
+
+            template <typename TSignature>
+            constexpr auto operator()(TSignature x) const
+            {
+                return x.hash_map();
+            }
+        };
+
+        struct flat_hash_storage
+        {
+            static constexpr const char* name = "flat hash buffer";
+
+            template <typename TSignature>
+            constexpr auto operator()(TSignature x) const
+            {
+                return x.storage_strategy(storage::flat_hash_buffer_maker{});
+            }
+        };
+
+        struct sparse_set_storage
+        {
+            static constexpr const char* name = "sparse set buffer";
+
+            template <typename TSignature>
+            constexpr auto operator()(TSignature x) const
+            {
+                return x.storage_strategy(storage::sparse_set_buffer_maker{});
+            }
+        };
+
+        template <typename TStorage, sz_t... TLanes>
+        constexpr auto make_csl_impl(std::index_sequence<TLanes...>)
+        {
+            namespace cs = ecst::signature::component;
+            namespace csl = ecst::signature_list::component;
+
+            constexpr TStorage storage{};
+
+            constexpr auto cs_seed = // .
+                cs::make(ct::seed).contiguous_buffer();
+
+            constexpr auto cs_sparse = // .
+                storage(cs::make(ct::sparse));
+
+            return csl::make(                                     // .
+                cs_seed,                                          // .
+                cs_sparse,                                        // .
+                cs::make(ct::lane<TLanes>).contiguous_buffer()... // .
+                );
+        }
+
+        // Builds and returns a "component signature list".
+        template <typename TStorage>
+        constexpr auto make_csl(TStorage)
+        {
+            return make_csl_impl<TStorage>(
+                std::make_index_sequence<synth_width>{});
+        }
+
+        // Inner parallelism strategy shared by all systems.
+        constexpr auto make_parallelism()
+        {
+            namespace ips = ecst::inner_parallelism::strategy;
+            namespace ipc = ecst::inner_parallelism::composer;
+
+            return ipc::none_below_threshold::v(
+                ecst::sz_v<EXAMPLE_SYNTH_PARALLEL_THRESHOLD>,
+                ips::split_evenly_fn::v_cores());
+        }
+
+        // Systems of the first layer have no dependencies.
+        template <sz_t TIdx>
+        constexpr auto make_work_signature(std::true_type)
+        {
+            namespace ss = ecst::signature::system;
+
+            return ss::make(st::work<TIdx>)           // .
+                .parallelism(make_parallelism())      // .
+                .write(ct::lane<TIdx % synth_width>); // .
+        }
+
+        // Other systems depend on the previous system of their lane.
+        template <sz_t TIdx>
+        constexpr auto make_work_signature(std::false_type)
+        {
+            namespace ss = ecst::signature::system;
+
+            return ss::make(st::work<TIdx>)                 // .
+                .parallelism(make_parallelism())            // .
+                .dependencies(st::work<TIdx - synth_width>) // .
+                .write(ct::lane<TIdx % synth_width>);       // .
+        }
+
+        template <sz_t TIdx>
+        constexpr auto make_work_signature()
+        {
+            using first_layer = std::integral_constant<bool,
+                (TIdx < synth_width)>;
+
+            return make_work_signature<TIdx>(first_layer{});
+        }
+
+        template <sz_t... TIdxs>
+        constexpr auto make_ssl_impl(std::index_sequence<TIdxs...>)
+        {
+            namespace ss = ecst::signature::system;
+            namespace sls = ecst::signature_list::system;
+
+            constexpr auto ss_churn =                // .
+                ss::make(st::churn)                  // .
+                    .parallelism(make_parallelism()) // .
+                    .write(ct::seed);                // .
+
+            constexpr auto ss_sparse_work =          // .
+                ss::make(st::sparse_work)            // .
+                    .parallelism(make_parallelism()) // .
+                    .write(ct::sparse);              // .
+
+            return sls::make(                   // .
+                ss_churn,                       // .
+                ss_sparse_work,                 // .
+                make_work_signature<TIdxs>()... // .
+                );
+        }
+
+        // Builds and returns a "system signature list".
+        constexpr auto make_ssl()
+        {
+            return make_ssl_impl(
+                std::make_index_sequence<synth_system_count>{});
+        }
+    }
+
+    namespace impl
+    {
+        template <typename TProxy, sz_t... TLanes>
+        void add_lane_components(
+            TProxy& proxy, ecst::entity_id eid, std::index_sequence<TLanes...>)
+        {
+            (void)std::initializer_list<int>{
+                (proxy.add_component(ct::lane<TLanes>, eid)._v = 0.f, 0)...};
+        }
+    }
+
+    template <typename TProxy>
+    void mk_entity(TProxy& proxy, std::uint32_t seed)
+    {
+        auto eid = proxy.create_entity();
+
+        auto& cs = proxy.add_component(ct::seed, eid);
+        cs._v = seed;
+
+        impl::add_lane_components(
+            proxy, eid, std::make_index_sequence<synth_width>{});
+
+        if(mix_seed(seed ^ 0x85ebca6bU) % 10000 < sparse_per_10k)
+        {
+            proxy.add_component(ct::sparse, eid)._v = 0.f;
+        }
+    }
+
+    // Number of entities currently alive. Churn replaces every killed entity,
+    // so every wave only creates the ones missing to reach its count.
+    sz_t alive_entity_count = 0;
+    sz_t current_wave = 0;
+    sz_t current_step = 0;
+
+    template <typename TContext>
+    void init_ctx(TContext& ctx)
+    {
+        example::_last_tp = hrc::now();
+
+        auto creation_begin = hrc::now();
+        const auto target = wave_entity_counts[current_wave];
+
+        ctx.step([&](auto& proxy)
+            {
+                for(; alive_entity_count < target; ++alive_entity_count)
+                {
+                    mk_entity(proxy,
+                        static_cast<std::uint32_t>(alive_entity_count));
+                }
+            });
+
+        _recorder.creation(elapsed_ms(creation_begin));
+    }
+
+    template <typename TContext, typename TRenderTarget>
+    void update_ctx(TContext& ctx, TRenderTarget&, ft)
+    {
+        namespace sea = ::ecst::system_execution_adapter;
+
+        // The refresh stage runs right after the step function returns.
+        tp refresh_begin;
+
+        ctx.step([&refresh_begin](auto& proxy)
+            {
+                proxy.execute_systems()(
+                    sea::all().detailed_instance(
+                        trace::instance([](auto& s, auto& data)
+                            {
+                                s.process(data);
+                            })));
+
+                refresh_begin = hrc::now();
+            });
+
+        _recorder.refresh(elapsed_ms(refresh_begin));
+
+        if(++current_step < steps_per_wave)
+        {
+            return;
+        }
+
+        current_step = 0;
+        example::bench(wave_entity_counts[current_wave]);
+
+        if(++current_wave == wave_entity_counts.size())
+        {
+            example::_running = false;
+            return;
+        }
+
+        init_ctx(ctx);
+    }
+}
+
+#include "./utils/headless_app.hpp"
+
+namespace impl
+{
+    template <typename TCSL, typename TSSL>
+    auto make_settings_list(TCSL csl, TSSL ssl)
+    {
+        namespace cs = ecst::settings;
+        namespace ss = ecst::scheduler;
+        namespace mp = ecst::mp;
+        namespace bh = ecst::bh;
+
+        // List of threading policies.
+        constexpr auto l_threading = mp::list::make( // .
+            ecst::settings::impl::v_allow_inner_parallelism,
+            ecst::settings::impl::v_disallow_inner_parallelism);
+
+        // Entity counts are only known at run-time, so the entity storage is
+        // always dynamic.
+        return bh::fold_right(l_threading, mp::list::empty_v,
+            [=](auto x_threading, auto xacc)
+            {
+                auto zsettings =                                  // .
+                    cs::make()                                    // .
+                        .set_threading(x_threading)               // .
+                        .set_storage(cs::dynamic<10000>)          // .
+                        .component_signatures(csl)                // .
+                        .system_signatures(ssl)                   // .
+                        .scheduler(cs::scheduler<ss::s_atomic_counter>);
+
+                return bh::append(xacc, zsettings);
+            });
+    }
+
+    template <typename TSettings>
+    auto make_ecst_context(TSettings)
+    {
+        return ecst::context::make(TSettings{});
+    }
+
+    template <typename TSettings, typename TF>
+    void do_test(TSettings, TF&& f)
+    {
+        // Create context.
+        using context_type = decltype(make_ecst_context(TSettings{}));
+        auto ctx_uptr = std::make_unique<context_type>();
+        auto& ctx = *ctx_uptr;
+
+        f(ctx);
+    }
+}
+
+template <typename TF, typename TCSL, typename TSSL>
+void run_tests(TF&& f, TCSL csl, TSSL ssl, const std::string& workload)
+{
+    using vrm::core::sz_t;
+    constexpr sz_t times = 3;
+
+    for(sz_t t = 0; t < times; ++t)
+    {
+        std::cout << "run " << t << "\n";
+        auto settings_list = impl::make_settings_list(csl, ssl);
+        ecst::bh::for_each(settings_list, [f, t, &workload](auto s)
+            {
+                auto entity_storage =
+                    ecst::settings::str::entity_storage<decltype(s)>();
+
+                auto multithreading =
+                    ecst::settings::str::multithreading<decltype(s)>();
+
+                std::cout << entity_storage << "\n"
+                          << multithreading << "\n"
+                          << workload << "\n";
+
+                auto settings_name = std::string{entity_storage} + " | " +
+                                     multithreading + " | " + workload;
+
+                example::_recorder.begin_settings(settings_name, t);
+                impl::do_test(s, f);
+            });
+    }
+
+    std::cout << "\n\n\n";
+}
+
+namespace
+{
+    // Parses a comma-separated list of entity counts, sorted in ascending
+    // order as entities are never removed between waves.
+    auto parse_entity_counts(const std::string& s)
+    {
+        std::vector<vrm::core::sz_t> result;
+        std::istringstream is{s};
+
+        for(std::string x; std::getline(is, x, ',');)
+        {
+            result.emplace_back(std::stoul(x));
+        }
+
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // Returns the number of CPUs the process is allowed to run on, or `0`
+    // where the affinity mask is not available.
+    int affinity_cpu_count()
+    {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+
+        if(sched_getaffinity(0, sizeof(set), &set) == 0)
+        {
+            return CPU_COUNT(&set);
+        }
+#endif
+
+        return 0;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // Optional basename of the JSON/CSV result files.
+    std::string results_basename{argc > 1 ? argv[1] : ""};
+
+    if(argc > 2)
+    {
+        example::wave_entity_counts = parse_entity_counts(argv[2]);
+    }
+
+    if(argc > 3)
+    {
+        example::per_entity_cost = std::stoul(argv[3]);
+    }
+
+    float churn_percent = argc > 4 ? std::stof(argv[4]) : 0.f;
+    example::churn_per_10k =
+        static_cast<std::uint32_t>(churn_percent * 100.f);
+
+    if(argc > 5)
+    {
+        example::steps_per_wave = std::stoul(argv[5]);
+    }
+
+    float sparse_percent = argc > 6 ? std::stof(argv[6]) : 1.f;
+    example::sparse_per_10k =
+        static_cast<std::uint32_t>(sparse_percent * 100.f);
+
+    std::ostringstream workload;
+    workload << "width " << example::synth_width << " | depth "
+             << example::synth_depth << " | cost " << example::per_entity_cost
+             << " | churn " << churn_percent << "% | sparse "
+             << sparse_percent << "% | cpus "
+             << affinity_cpu_count() << " | hardware threads "
+             << std::thread::hardware_concurrency();
+
+    // Churn replaces every killed entity, so the entity count of every wave
+    // stays constant and its throughput is meaningful.
+    example::_recorder.enable_throughput();
+
+    auto doit = [&](auto& ctx)
+    {
+        // Run the simulation.
+        example::_running = true;
+        example::alive_entity_count = 0;
+        example::current_wave = 0;
+        example::current_step = 0;
+        example::run_simulation(ctx);
+    };
+
+    // Run every setting with each storage of the `sparse` component.
+    auto run_with_storage = [&](auto storage)
+    {
+        run_tests(doit, example::ecst_setup::make_csl(storage),
+            example::ecst_setup::make_ssl(),
+            workload.str() + " | " + decltype(storage)::name);
+    };
+
+    run_with_storage(example::ecst_setup::hash_map_storage{});
+    run_with_storage(example::ecst_setup::flat_hash_storage{});
+    run_with_storage(example::ecst_setup::sparse_set_storage{});
+
+    if(!results_basename.empty())
+    {
+        example::_recorder.write_files(results_basename);
+    }
+}
@@ -0,0 +1,359 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+// Microbenchmark of tiny systems: the work done by every subtask is
+// comparable to the cost of dispatching and waiting for it, so the recorded
+// step times mostly measure ECST's per-step and per-subtask overhead.
+
+#include "./utils/dependencies.hpp"
+
+namespace example
+{
+    // Component definitions.
+    namespace c
+    {
+        struct position
+        {
+            float _v;
+        };
+
+        struct velocity
+        {
+            float _v;
+        };
+
+        struct acceleration
+        {
+            float _v;
+        };
+
+        struct life
+        {
+            float _v;
+        };
+    }
+}
+
+// Component tags, in namespace `example::ct`.
+EXAMPLE_COMPONENT_TAG(acceleration);
+EXAMPLE_COMPONENT_TAG(velocity);
+EXAMPLE_COMPONENT_TAG(position);
+EXAMPLE_COMPONENT_TAG(life);
+
+// System tags, in namespace `example::st`.
+EXAMPLE_SYSTEM_TAG(acceleration);
+EXAMPLE_SYSTEM_TAG(velocity);
+EXAMPLE_SYSTEM_TAG(fade);
+
+namespace example
+{
+    namespace s
+    {
+        struct acceleration
+        {
+            template <typename TData>
+            void process(ft dt, TData& data)
+            {
+                data.for_entities([&](auto eid)
+                    {
+                        auto& v = data.get(ct::velocity, eid)._v;
+                        const auto& a = data.get(ct::acceleration, eid)._v;
+
+                        v += a * dt;
+                    });
+            }
+        };
+
+        struct velocity
+        {
+            template <typename TData>
+            void process(ft dt, TData& data)
+            {
+                data.for_entities([&](auto eid)
+                    {
+                        auto& p = data.get(ct::position, eid)._v;
+                        const auto& v = data.get(ct::velocity, eid)._v;
+
+                        p += v * dt;
+                    });
+            }
+        };
+
+        struct fade
+        {
+            template <typename TData>
+            void process(ft dt, TData& data)
+            {
+                data.for_entities([&](auto eid)
+                    {
+                        auto& l = data.get(ct::life, eid)._v;
+                        l -= dt;
+                    });
+            }
+        };
+    }
+
+    // Compile-time `std::size_t` entity limit.
+    constexpr auto entity_limit = ecst::sz_v<1000 * 4 * 4>;
+
+    // Run-time particle count and number of steps of every wave.
+    sz_t initial_particle_count = 1000;
+    sz_t steps_per_wave = 2000;
+
+    namespace ecst_setup
+    {
+        // Builds and returns a "component signature list".
+        constexpr auto make_csl()
+        {
+            namespace cs = ecst::signature::component;
+            namespace csl = ecst::signature_list::component;
+
+            constexpr auto cs_acceleration = // .
+                cs::make(ct::acceleration).contiguous_buffer();
+
+            constexpr auto cs_velocity = // .
+                cs::make(ct::velocity).contiguous_buffer();
+
+            constexpr auto cs_position = // .
+                cs::make(ct::position).contiguous_buffer();
+
+            constexpr auto cs_life = // .
+                cs::make(ct::life).contiguous_buffer();
+
+            return csl::make(    // .
+                cs_acceleration, // .
+                cs_velocity,     // .
+                cs_position,     // .
+                cs_life          // .
+                );
+        }
+
+        // Builds and returns a "system signature list".
+        constexpr auto make_ssl()
+        {
+            // Signature namespace aliases.
+            namespace ss = ecst::signature::system;
+            namespace sls = ecst::signature_list::system;
+
+            // Inner parallelism aliases and definitions.
+            namespace ips = ecst::inner_parallelism::strategy;
+            constexpr auto split_evenly_per_core =
+                ips::split_evenly_fn::v_cores();
+
+            constexpr auto ss_acceleration =            // .
+                ss::make(st::acceleration)              // .
+                    .parallelism(split_evenly_per_core) // .
+                    .read(ct::acceleration)             // .
+                    .write(ct::velocity);               // .
+
+            constexpr auto ss_velocity =                // .
+                ss::make(st::velocity)                  // .
+                    .parallelism(split_evenly_per_core) // .
+                    .dependencies(st::acceleration)     // .
+                    .read(ct::velocity)                 // .
+                    .write(ct::position);               // .
+
+            constexpr auto ss_fade =                    // .
+                ss::make(st::fade)                      // .
+                    .parallelism(split_evenly_per_core) // .
+                    .write(ct::life);                   // .
+
+            return sls::make(    // .
+                ss_acceleration, // .
+                ss_velocity,     // .
+                ss_fade          // .
+                );
+        }
+    }
+
+    template <typename TProxy>
+    void mk_particle(TProxy& proxy)
+    {
+        auto eid = proxy.create_entity();
+
+        auto& ca = proxy.add_component(ct::acceleration, eid);
+        ca._v = 1.f;
+
+        auto& cv = proxy.add_component(ct::velocity, eid);
+        cv._v = rndf(-3, 3);
+
+        auto& cp = proxy.add_component(ct::position, eid);
+        cp._v = rndf(0, 100);
+
+        auto& cl = proxy.add_component(ct::life, eid);
+        cl._v = rndf(5, 25);
+    }
+
+    // Number of particles currently alive. Particles never die, so every wave
+    // only creates the ones missing to reach `initial_particle_count`.
+    sz_t alive_particle_count = 0;
+
+    template <typename TContext>
+    void init_ctx(TContext& ctx)
+    {
+        example::_last_tp = hrc::now();
+
+        auto creation_begin = hrc::now();
+
+        ctx.step([&](auto& proxy)
+            {
+                for(; alive_particle_count < initial_particle_count;
+                    ++alive_particle_count)
+                {
+                    mk_particle(proxy);
+                }
+            });
+
+        _recorder.creation(elapsed_ms(creation_begin));
+    }
+
+    std::size_t remaining_waves = 2;
+    sz_t current_step = 0;
+
+    template <typename TContext, typename TRenderTarget>
+    void update_ctx(TContext& ctx, TRenderTarget&, ft dt)
+    {
+        namespace sea = ::ecst::system_execution_adapter;
+
+        ctx.step([dt](auto& proxy)
+            {
+                proxy.execute_systems()(
+                    sea::all().detailed_instance(
+                        trace::instance([dt](auto& s, auto& data)
+                            {
+                                s.process(dt, data);
+                            })));
+            });
+
+        if(++current_step < steps_per_wave)
+        {
+            return;
+        }
+
+        current_step = 0;
+        example::bench(initial_particle_count);
+
+        if(remaining_waves == 0)
+        {
+            example::_running = false;
+            return;
+        }
+
+        --remaining_waves;
+        initial_particle_count *= 4;
+        example::reseed();
+        init_ctx(ctx);
+    }
+}
+
+#ifdef EXAMPLE_HEADLESS
+#include "./utils/headless_app.hpp"
+#else
+#include "./utils/pres_game_app.hpp"
+#endif
+
+namespace impl
+{
+    template <typename TEntityCount, typename TCSL, typename TSSL>
+    auto make_settings_list(TEntityCount ec, TCSL csl, TSSL ssl)
+    {
+        namespace cs = ecst::settings;
+        namespace ss = ecst::scheduler;
+        namespace mp = ecst::mp;
+        namespace bh = ecst::bh;
+
+        // List of threading policies.
+        constexpr auto l_threading = mp::list::make( // .
+            ecst::settings::impl::v_allow_inner_parallelism,
+            ecst::settings::impl::v_disallow_inner_parallelism);
+
+        return bh::fold_right(l_threading, mp::list::empty_v,
+            [=](auto x_threading, auto xacc)
+            {
+                auto zsettings =                                  // .
+                    cs::make()                                    // .
+                        .set_threading(x_threading)               // .
+                        .set_storage(cs::fixed<decltype(ec){}>)   // .
+                        .component_signatures(csl)                // .
+                        .system_signatures(ssl)                   // .
+                        .scheduler(cs::scheduler<ss::s_atomic_counter>);
+
+                return bh::append(xacc, zsettings);
+            });
+    }
+
+    template <typename TSettings>
+    auto make_ecst_context(TSettings)
+    {
+        return ecst::context::make(TSettings{});
+    }
+
+    template <typename TSettings, typename TF>
+    void do_test(TSettings, TF&& f)
+    {
+        // Create context.
+        using context_type = decltype(make_ecst_context(TSettings{}));
+        auto ctx_uptr = std::make_unique<context_type>();
+        auto& ctx = *ctx_uptr;
+
+        f(ctx);
+    }
+}
+
+template <typename TF, typename TEntityCount, typename TCSL, typename TSSL>
+void run_tests(TF&& f, TEntityCount ec, TCSL csl, TSSL ssl)
+{
+    using vrm::core::sz_t;
+    constexpr sz_t times = 3;
+
+    for(sz_t t = 0; t < times; ++t)
+    {
+        std::cout << "run " << t << "\n";
+        auto settings_list = impl::make_settings_list(ec, csl, ssl);
+        ecst::bh::for_each(settings_list, [f, t](auto s)
+            {
+                auto entity_storage =
+                    ecst::settings::str::entity_storage<decltype(s)>();
+
+                auto multithreading =
+                    ecst::settings::str::multithreading<decltype(s)>();
+
+                std::cout << entity_storage << "\n"
+                          << multithreading << "\n";
+
+                example::_recorder.begin_settings(
+                    std::string{entity_storage} + " | " + multithreading, t);
+                impl::do_test(s, f);
+            });
+    }
+
+    std::cout << "\n\n\n";
+}
+
+int main(int argc, char** argv)
+{
+    // Optional basename of the JSON/CSV result files.
+    std::string results_basename{argc > 1 ? argv[1] : ""};
+
+    auto doit = [&](auto& ctx)
+    {
+        // Run the simulation.
+        example::initial_particle_count = 1000;
+        example::_running = true;
+        example::remaining_waves = 2;
+        example::current_step = 0;
+        example::alive_particle_count = 0;
+        example::reseed();
+        example::run_simulation(ctx);
+    };
+
+    run_tests(doit, example::entity_limit, example::ecst_setup::make_csl(),
+        example::ecst_setup::make_ssl());
+
+    if(!results_basename.empty())
+    {
+        example::_recorder.write_files(results_basename);
+    }
+}
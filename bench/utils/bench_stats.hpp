@@ -0,0 +1,403 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <vrm/core/type_aliases.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace example
+{
+    namespace bench_stats
+    {
+        using vrm::core::sz_t;
+
+        // Returns the `p`-th percentile of `xs`, using the nearest-rank
+        // method. `xs` is taken by value as it needs to be sorted.
+        inline float percentile(std::vector<float> xs, float p)
+        {
+            if(xs.empty())
+            {
+                return 0.f;
+            }
+
+            std::sort(std::begin(xs), std::end(xs));
+
+            auto rank = static_cast<sz_t>(std::ceil(p / 100.f * xs.size()));
+            return xs[std::max(rank, sz_t(1)) - 1];
+        }
+
+        inline float sum(const std::vector<float>& xs)
+        {
+            float acc = 0.f;
+            for(auto x : xs)
+            {
+                acc += x;
+            }
+
+            return acc;
+        }
+
+        inline float mean(const std::vector<float>& xs)
+        {
+            return xs.empty() ? 0.f : sum(xs) / xs.size();
+        }
+
+        // Escapes `s` so that it can be used as a JSON string literal.
+        inline std::string json_escape(const std::string& s)
+        {
+            std::string result;
+            result.reserve(s.size());
+
+            for(auto c : s)
+            {
+                if(c == '"' || c == '\\')
+                {
+                    result += '\\';
+                }
+
+                result += c;
+            }
+
+            return result;
+        }
+
+        // Escapes `s` so that it can be used as a quoted CSV field.
+        inline std::string csv_escape(const std::string& s)
+        {
+            std::string result;
+            result.reserve(s.size());
+
+            for(auto c : s)
+            {
+                if(c == '"')
+                {
+                    result += '"';
+                }
+
+                result += c;
+            }
+
+            return result;
+        }
+
+        // Resets the peak resident set size reported by `peak_rss_kb` to the
+        // current resident set size. Only supported on Linux: elsewhere the
+        // peak is the one of the whole process.
+        inline void reset_peak_rss()
+        {
+#if defined(__linux__)
+            std::ofstream{"/proc/self/clear_refs"} << "5";
+#endif
+        }
+
+        // Returns the peak resident set size since the last `reset_peak_rss`
+        // call, in kilobytes. Falls back to the peak of the process so far,
+        // as reported by `getrusage`, or to `0` where it is not available.
+        inline long peak_rss_kb()
+        {
+#if defined(__linux__)
+            std::ifstream status{"/proc/self/status"};
+            for(std::string line; std::getline(status, line);)
+            {
+                if(line.compare(0, 6, "VmHWM:") == 0)
+                {
+                    return std::stol(line.substr(6));
+                }
+            }
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+            rusage usage;
+            getrusage(RUSAGE_SELF, &usage);
+            return usage.ru_maxrss;
+#else
+            return 0;
+#endif
+        }
+
+        inline void write_json_array(
+            std::ostream& os, const std::vector<float>& xs)
+        {
+            os << "[";
+
+            for(sz_t i = 0; i < xs.size(); ++i)
+            {
+                os << (i == 0 ? "" : ", ") << xs[i];
+            }
+
+            os << "]";
+        }
+
+        // Timings of a single wave of a simulation.
+        struct wave
+        {
+            // Settings combination and run index of the wave.
+            std::string _settings;
+            sz_t _run;
+
+            // Number of entities the wave was started with.
+            sz_t _entity_count;
+
+            // Wall time of the whole wave and of every step.
+            float _total_ms;
+            std::vector<float> _step_ms;
+
+            // Wall time of the refresh stage of every measured step.
+            std::vector<float> _refresh_ms;
+
+            // Wall time spent creating the initial entities of the wave,
+            // including the refresh that matches them to systems.
+            float _creation_ms;
+
+            // Subscriber set disorder ratio of every measured step.
+            std::vector<float> _disorder;
+
+            // Peak resident set size during the wave. Memory kept by the
+            // allocator from previous waves and settings is included.
+            long _peak_rss_kb;
+
+            // Entities processed per second of step time, assuming that the
+            // entity count stays `_entity_count` during the whole wave.
+            float entities_per_s() const
+            {
+                auto step_s = sum(_step_ms) / 1000.f;
+                return step_s <= 0.f
+                           ? 0.f
+                           : _entity_count * _step_ms.size() / step_s;
+            }
+        };
+
+        // Collects step and wave timings for every settings combination, and
+        // emits them as JSON or CSV.
+        class recorder
+        {
+        private:
+            std::vector<wave> _waves;
+            std::vector<float> _pending_steps;
+            std::vector<float> _pending_refreshes;
+            float _pending_creation_ms{0.f};
+            std::vector<float> _pending_disorder;
+            std::string _settings;
+            sz_t _run{0};
+
+            // Set by `end_wave`: the current wave is closed once its last
+            // step has been recorded.
+            bool _closing{false};
+            sz_t _closing_entity_count{0};
+            float _closing_total_ms{0.f};
+
+            // Creation time of the next wave, spent during the last step of
+            // the closing wave.
+            float _next_creation_ms{0.f};
+
+            bool _throughput{false};
+
+            void close_wave()
+            {
+                _waves.emplace_back(wave{_settings, _run,
+                    _closing_entity_count, _closing_total_ms,
+                    std::move(_pending_steps), std::move(_pending_refreshes),
+                    _pending_creation_ms, std::move(_pending_disorder),
+                    peak_rss_kb()});
+
+                _pending_steps.clear();
+                _pending_refreshes.clear();
+                _pending_creation_ms = _next_creation_ms;
+                _pending_disorder.clear();
+
+                _closing = false;
+                _next_creation_ms = 0.f;
+
+                reset_peak_rss();
+            }
+
+        public:
+            // Emits the entities per second of every wave. Only meaningful
+            // for simulations whose entity count stays constant during a
+            // wave.
+            void enable_throughput() noexcept
+            {
+                _throughput = true;
+            }
+
+            // Starts recording a new settings combination.
+            void begin_settings(const std::string& settings, sz_t run)
+            {
+                _settings = settings;
+                _run = run;
+                _pending_steps.clear();
+                _pending_refreshes.clear();
+                _pending_creation_ms = 0.f;
+                _pending_disorder.clear();
+                _closing = false;
+                _next_creation_ms = 0.f;
+
+                reset_peak_rss();
+            }
+
+            // Records the wall time of a single step. If `end_wave` was called
+            // during the step, the step is the last one of the current wave,
+            // which is then closed. The time spent creating the next wave in
+            // that step is not included.
+            void step(float ms)
+            {
+                if(!_closing)
+                {
+                    _pending_steps.emplace_back(ms);
+                    return;
+                }
+
+                _pending_steps.emplace_back(
+                    std::max(ms - _next_creation_ms, 0.f));
+
+                close_wave();
+            }
+
+            // Records the wall time of the refresh stage of a single step.
+            void refresh(float ms)
+            {
+                _pending_refreshes.emplace_back(ms);
+            }
+
+            // Records the time spent creating the entities of the current
+            // wave, or of the next one after `end_wave`. Multiple creations in
+            // the same wave are summed.
+            void creation(float ms)
+            {
+                (_closing ? _next_creation_ms : _pending_creation_ms) += ms;
+            }
+
+            // Records the subscriber set disorder ratio of a single step.
+            void disorder(float ratio)
+            {
+                _pending_disorder.emplace_back(ratio);
+            }
+
+            // Total refresh time recorded in the current wave so far.
+            float pending_refresh_ms() const
+            {
+                return sum(_pending_refreshes);
+            }
+
+            // Ends the current wave. It is closed by the next `step` call,
+            // which records the step `end_wave` was called from.
+            void end_wave(sz_t entity_count, float total_ms)
+            {
+                _closing = true;
+                _closing_entity_count = entity_count;
+                _closing_total_ms = total_ms;
+            }
+
+            const auto& waves() const noexcept
+            {
+                return _waves;
+            }
+
+            void write_json(std::ostream& os) const
+            {
+                os << "[\n";
+
+                for(sz_t i = 0; i < _waves.size(); ++i)
+                {
+                    const auto& w = _waves[i];
+
+                    os << "  {\"settings\": \"" << json_escape(w._settings)
+                       << "\", \"run\": " << w._run
+                       << ", \"entity_count\": " << w._entity_count
+                       << ", \"total_ms\": " << w._total_ms
+                       << ", \"creation_ms\": " << w._creation_ms
+                       << ", \"mean_ms\": " << mean(w._step_ms)
+                       << ", \"p50_ms\": " << percentile(w._step_ms, 50)
+                       << ", \"p95_ms\": " << percentile(w._step_ms, 95)
+                       << ", \"p99_ms\": " << percentile(w._step_ms, 99)
+                       << ", \"refresh_total_ms\": " << sum(w._refresh_ms)
+                       << ", \"refresh_p50_ms\": "
+                       << percentile(w._refresh_ms, 50)
+                       << ", \"refresh_p95_ms\": "
+                       << percentile(w._refresh_ms, 95)
+                       << ", \"refresh_p99_ms\": "
+                       << percentile(w._refresh_ms, 99)
+                       << ", \"disorder_mean\": " << mean(w._disorder)
+                       << ", \"disorder_max\": "
+                       << percentile(w._disorder, 100)
+                       << ", \"peak_rss_kb\": " << w._peak_rss_kb;
+
+                    if(_throughput)
+                    {
+                        os << ", \"entities_per_s\": " << w.entities_per_s();
+                    }
+
+                    os << ", \"step_ms\": ";
+
+                    write_json_array(os, w._step_ms);
+                    os << ", \"refresh_ms\": ";
+                    write_json_array(os, w._refresh_ms);
+
+                    os << "}" << (i + 1 == _waves.size() ? "" : ",") << "\n";
+                }
+
+                os << "]\n";
+            }
+
+            void write_csv(std::ostream& os) const
+            {
+                os << "settings,run,entity_count,steps,total_ms,creation_ms,"
+                      "mean_ms,"
+                      "p50_ms,p95_ms,p99_ms,refresh_total_ms,refresh_p50_ms,"
+                      "refresh_p95_ms,refresh_p99_ms,disorder_mean,"
+                      "disorder_max,peak_rss_kb"
+                   << (_throughput ? ",entities_per_s" : "") << "\n";
+
+                for(const auto& w : _waves)
+                {
+                    os << "\"" << csv_escape(w._settings) << "\","
+                       << w._run << "," << w._entity_count << ","
+                       << w._step_ms.size() << "," << w._total_ms << ","
+                       << w._creation_ms << "," << mean(w._step_ms) << ","
+                       << percentile(w._step_ms, 50) << ","
+                       << percentile(w._step_ms, 95) << ","
+                       << percentile(w._step_ms, 99) << ","
+                       << sum(w._refresh_ms) << ","
+                       << percentile(w._refresh_ms, 50) << ","
+                       << percentile(w._refresh_ms, 95) << ","
+                       << percentile(w._refresh_ms, 99) << ","
+                       << mean(w._disorder) << ","
+                       << percentile(w._disorder, 100) << ","
+                       << w._peak_rss_kb;
+
+                    if(_throughput)
+                    {
+                        os << "," << w.entities_per_s();
+                    }
+
+                    os << "\n";
+                }
+            }
+
+            // Writes `<basename>.json` and `<basename>.csv`.
+            void write_files(const std::string& basename) const
+            {
+                std::ofstream json{basename + ".json"};
+                write_json(json);
+
+                std::ofstream csv{basename + ".csv"};
+                write_csv(csv);
+            }
+        };
+    }
+
+    // Global recorder, filled by the running application and by `bench`.
+    bench_stats::recorder _recorder;
+}
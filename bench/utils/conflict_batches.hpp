@@ -0,0 +1,195 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "./dependencies.hpp"
+
+namespace example
+{
+    // Contiguous range of items belonging to a batch.
+    template <typename T>
+    struct batch_range
+    {
+        const T* _begin;
+        const T* _end;
+
+        auto begin() const noexcept
+        {
+            return _begin;
+        }
+
+        auto end() const noexcept
+        {
+            return _end;
+        }
+
+        auto size() const noexcept
+        {
+            return static_cast<sz_t>(_end - _begin);
+        }
+
+        const auto& operator[](sz_t i) const noexcept
+        {
+            return _begin[i];
+        }
+    };
+
+    // Partitions items involving two entities (`_e0` and `_e1`, e.g.
+    // contacts) into batches of items that do not share any entity. Items of
+    // a batch can be processed in parallel, and batches must be processed in
+    // sequence.
+    //
+    // Two colorings are available:
+    // * Order-preserving: every item is put in the batch following the last
+    //   batch of both of its entities. The items of every entity are thus
+    //   processed in their original order, and results are bit-identical to
+    //   processing all items serially.
+    // * Greedy: every item is put in the first batch not containing any of
+    //   its entities. Produces fewer, larger batches. Items exceeding
+    //   `max_greedy_batches` are put in a final batch that must be processed
+    //   serially.
+    //
+    // Storage is allocated once and only grows with the item count and the
+    // largest entity ID.
+    template <typename T>
+    class conflict_batches
+    {
+    public:
+        static constexpr sz_t max_greedy_batches = 64;
+
+    private:
+        // Per entity: `1 +` the index of the last batch containing it
+        // (order-preserving), or the mask of batches containing it (greedy).
+        // Reset after every `build`.
+        std::vector<std::uint64_t> _entity_state;
+
+        std::vector<std::uint32_t> _item_batch;
+
+        // Start of every batch in `_items`, plus the total item count.
+        std::vector<std::uint32_t> _offsets;
+        std::vector<std::uint32_t> _cursors;
+
+        std::vector<T> _items;
+        bool _last_serial{false};
+
+        static auto idx(ecst::entity_id eid) noexcept
+        {
+            return static_cast<sz_t>(eid);
+        }
+
+        auto order_preserving_batch(const T& x) noexcept
+        {
+            auto& s0 = _entity_state[idx(x._e0)];
+            auto& s1 = _entity_state[idx(x._e1)];
+
+            auto b = std::max(s0, s1);
+            s0 = s1 = b + 1;
+
+            return static_cast<std::uint32_t>(b);
+        }
+
+        auto greedy_batch(const T& x) noexcept
+        {
+            auto& s0 = _entity_state[idx(x._e0)];
+            auto& s1 = _entity_state[idx(x._e1)];
+
+            auto used = s0 | s1;
+
+            std::uint32_t b = 0;
+            while(b < max_greedy_batches && (used & (std::uint64_t(1) << b)))
+            {
+                ++b;
+            }
+
+            if(b < max_greedy_batches)
+            {
+                s0 |= std::uint64_t(1) << b;
+                s1 |= std::uint64_t(1) << b;
+            }
+
+            return b;
+        }
+
+    public:
+        void build(const std::vector<T>& items, bool preserve_order)
+        {
+            sz_t max_idx = 0;
+            for(const auto& x : items)
+            {
+                max_idx = std::max({max_idx, idx(x._e0), idx(x._e1)});
+            }
+
+            if(_entity_state.size() <= max_idx)
+            {
+                _entity_state.resize(max_idx + 1, 0);
+            }
+
+            // Assign a batch to every item.
+            _item_batch.resize(items.size());
+            sz_t batch_count = 0;
+
+            for(sz_t i = 0; i < items.size(); ++i)
+            {
+                auto b = preserve_order ? order_preserving_batch(items[i])
+                                        : greedy_batch(items[i]);
+
+                _item_batch[i] = b;
+                batch_count = std::max(batch_count, sz_t(b) + 1);
+            }
+
+            _last_serial =
+                !preserve_order && batch_count > max_greedy_batches;
+
+            // Counting sort of the items by batch, keeping their relative
+            // order.
+            _offsets.assign(batch_count + 1, 0);
+            for(auto b : _item_batch)
+            {
+                ++_offsets[b + 1];
+            }
+
+            for(sz_t b = 0; b < batch_count; ++b)
+            {
+                _offsets[b + 1] += _offsets[b];
+            }
+
+            _cursors.assign(_offsets.begin(), _offsets.end() - 1);
+            _items.assign(items.begin(), items.end());
+
+            for(sz_t i = 0; i < items.size(); ++i)
+            {
+                _items[_cursors[_item_batch[i]]++] = items[i];
+            }
+
+            for(const auto& x : items)
+            {
+                _entity_state[idx(x._e0)] = 0;
+                _entity_state[idx(x._e1)] = 0;
+            }
+        }
+
+        auto batch_count() const noexcept
+        {
+            return _offsets.empty() ? sz_t(0) : _offsets.size() - 1;
+        }
+
+        auto batch(sz_t i) const noexcept
+        {
+            const auto* data = _items.data();
+            return batch_range<T>{data + _offsets[i], data + _offsets[i + 1]};
+        }
+
+        // Returns whether the items of the `i`-th batch may conflict, and
+        // must be processed serially.
+        auto serial(sz_t i) const noexcept
+        {
+            return _last_serial && i == batch_count() - 1;
+        }
+    };
+}
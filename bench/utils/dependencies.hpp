@@ -13,6 +13,9 @@
 
 #include <ecst.hpp>
 
+#include "./bench_stats.hpp"
+#include "./trace.hpp"
+
 namespace example
 {
     // Type aliases.
@@ -35,11 +38,25 @@ namespace example
 
     tp _last_tp = hrc::now();
 
-    inline void bench()
+    // Milliseconds elapsed since `x`.
+    inline float elapsed_ms(const tp& x) noexcept
+    {
+        using ft_ms = std::chrono::duration<float, std::milli>;
+        return std::chrono::duration_cast<ft_ms>(hrc::now() - x).count();
+    }
+
+    // Prints and records the duration of the wave started with
+    // `entity_count` entities, and the time spent in its refresh stages.
+    inline void bench(sz_t entity_count)
     {
         auto x = hrc::now() - _last_tp;
         _last_tp = hrc::now();
-        std::cout << std::chrono::duration_cast<dur>(x).count() << std::endl;
+
+        auto ms = std::chrono::duration_cast<dur>(x).count();
+        std::cout << entity_count << ": " << ms << " (refresh: "
+                  << _recorder.pending_refresh_ms() << ")" << std::endl;
+
+        _recorder.end_wave(entity_count, ms);
     }
 }
 
@@ -0,0 +1,74 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include <atomic>
+#include "./dependencies.hpp"
+
+// Define `EXAMPLE_MEASURE_DISORDER` to measure how disordered the subscriber
+// sets of the systems passed to `measure_disorder` are. When it is not
+// defined, `measure_disorder` does nothing.
+
+namespace example
+{
+    // Counts, over all subtasks of a step, how many consecutive pairs of
+    // visited entity IDs are in descending order. The resulting ratio is `0`
+    // for a subscriber set iterated in ID order, and about `0.5` for a set in
+    // random order.
+    class disorder_counter
+    {
+    private:
+        std::atomic<sz_t> _pairs{0};
+        std::atomic<sz_t> _descents{0};
+
+    public:
+        // Iterates over the entities of a subtask. Can be called concurrently
+        // from multiple subtasks.
+        template <typename TData>
+        void measure(TData& data)
+        {
+            sz_t pairs = 0, descents = 0;
+            bool first = true;
+            ecst::entity_id prev{};
+
+            data.for_entities([&](auto eid)
+                {
+                    if(!first)
+                    {
+                        ++pairs;
+                        descents += (eid < prev) ? 1 : 0;
+                    }
+
+                    first = false;
+                    prev = eid;
+                });
+
+            _pairs.fetch_add(pairs, std::memory_order_relaxed);
+            _descents.fetch_add(descents, std::memory_order_relaxed);
+        }
+
+        // Returns the ratio measured since the last call, and resets it.
+        float take() noexcept
+        {
+            auto pairs = _pairs.exchange(0, std::memory_order_relaxed);
+            auto descents = _descents.exchange(0, std::memory_order_relaxed);
+
+            return pairs == 0 ? 0.f : static_cast<float>(descents) / pairs;
+        }
+    };
+
+    disorder_counter _disorder_counter;
+
+    template <typename TData>
+    void measure_disorder(TData& data)
+    {
+#ifdef EXAMPLE_MEASURE_DISORDER
+        _disorder_counter.measure(data);
+#else
+        (void)data;
+#endif
+    }
+}
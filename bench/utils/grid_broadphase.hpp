@@ -0,0 +1,147 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "./dependencies.hpp"
+
+namespace example
+{
+    // Contiguous range of entity IDs belonging to a grid cell.
+    struct cell_range
+    {
+        const ecst::entity_id* _begin;
+        const ecst::entity_id* _end;
+
+        auto begin() const noexcept
+        {
+            return _begin;
+        }
+
+        auto end() const noexcept
+        {
+            return _end;
+        }
+    };
+
+    // Uniform grid broadphase with a counting-sort layout: all entity IDs are
+    // stored in a single flat array, sorted by cell, and every cell is a
+    // contiguous range of that array.
+    //
+    // The grid is filled every frame in four phases:
+    // 1. `clear` (serial) resets the per-cell counters.
+    // 2. `count` (parallel) builds the per-cell histogram.
+    // 3. `prefix_sum` (serial) computes the cell offsets.
+    // 4. `insert` (parallel) scatters the entity IDs to their cells.
+    //
+    // Phases must be separated by a synchronization point (e.g. a system
+    // dependency). Storage is allocated once and only grows when the entity
+    // count exceeds its previous high-water mark.
+    template <sz_t TWidth, sz_t THeight>
+    class grid_broadphase
+    {
+    public:
+        static constexpr sz_t width = TWidth;
+        static constexpr sz_t height = THeight;
+        static constexpr sz_t cell_count = width * height;
+
+    private:
+        using counter_type = std::atomic<std::uint32_t>;
+
+        // Per-cell histogram during `count`, per-cell write cursor during
+        // `insert`.
+        std::vector<counter_type> _counters;
+
+        // Start of every cell in `_entities`, plus the total entity count.
+        std::vector<std::uint32_t> _offsets;
+
+        std::vector<ecst::entity_id> _entities;
+
+    public:
+        grid_broadphase() : _counters(cell_count), _offsets(cell_count + 1, 0)
+        {
+        }
+
+        // Returns the index of the cell at column `x` and row `y`.
+        static constexpr auto cell_idx(sz_t x, sz_t y) noexcept
+        {
+            return y * width + x;
+        }
+
+        void clear() noexcept
+        {
+            for(auto& c : _counters)
+            {
+                c.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        void count(sz_t cell) noexcept
+        {
+            _counters[cell].fetch_add(1, std::memory_order_relaxed);
+        }
+
+        void prefix_sum()
+        {
+            std::uint32_t acc = 0;
+
+            for(sz_t i = 0; i < cell_count; ++i)
+            {
+                _offsets[i] = acc;
+                acc += _counters[i].load(std::memory_order_relaxed);
+                _counters[i].store(_offsets[i], std::memory_order_relaxed);
+            }
+
+            _offsets[cell_count] = acc;
+
+            if(_entities.size() < acc)
+            {
+                _entities.resize(acc);
+            }
+        }
+
+        void insert(sz_t cell, ecst::entity_id eid) noexcept
+        {
+            auto slot =
+                _counters[cell].fetch_add(1, std::memory_order_relaxed);
+
+            _entities[slot] = eid;
+        }
+
+        auto cell(sz_t idx) const noexcept
+        {
+            const auto* data = _entities.data();
+            return cell_range{data + _offsets[idx], data + _offsets[idx + 1]};
+        }
+
+        auto cell(sz_t x, sz_t y) const noexcept
+        {
+            return cell(cell_idx(x, y));
+        }
+
+        // Executes `f` on the cell at column `x` and row `y` and on all of its
+        // existing neighbours.
+        template <typename TF>
+        void for_neighbourhood(sz_t x, sz_t y, TF&& f) const
+        {
+            auto s_x = std::max(x, sz_t(1)) - 1;
+            auto e_x = std::min(x + 1, width - 1);
+            auto s_y = std::max(y, sz_t(1)) - 1;
+            auto e_y = std::min(y + 1, height - 1);
+
+            for(auto iy(s_y); iy <= e_y; ++iy)
+            {
+                for(auto ix(s_x); ix <= e_x; ++ix)
+                {
+                    f(cell(ix, iy));
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include "./dependencies.hpp"
+
+namespace example
+{
+    // Render target that collects draw calls without drawing anything.
+    // Drawn vertices and instances are counted so that render outputs are
+    // still consumed.
+    class null_render_target
+    {
+    private:
+        sz_t _vertex_count{0};
+        sz_t _instance_count{0};
+
+    public:
+        template <typename TVertex, typename... Ts>
+        void draw(const TVertex*, sz_t count, Ts&&...) noexcept
+        {
+            _vertex_count += count;
+        }
+
+        // Stands for an instanced draw call, whose per-instance geometry
+        // would be expanded by the GPU.
+        template <typename TInstance>
+        void draw_instances(const TInstance*, sz_t count) noexcept
+        {
+            _instance_count += count;
+        }
+
+        void clear() noexcept
+        {
+            _vertex_count = 0;
+            _instance_count = 0;
+        }
+
+        auto vertex_count() const noexcept
+        {
+            return _vertex_count;
+        }
+
+        auto instance_count() const noexcept
+        {
+            return _instance_count;
+        }
+    };
+
+    // Drives `update_ctx` with a fixed `dt` and no window, recording the wall
+    // time of every step in `_recorder`. Writing trace files, if enabled, is
+    // excluded from the recorded step times.
+    template <typename TContext>
+    class headless_app
+    {
+    private:
+        TContext& _ctx;
+        null_render_target _rt;
+
+        void init_loops()
+        {
+            using ft_dur = std::chrono::duration<ft, std::ratio<1, 1000>>;
+
+            constexpr ft dt = 0.04f;
+
+            while(true)
+            {
+                _rt.clear();
+
+                trace::_tracer.begin_step();
+
+                auto cb = hrc::now();
+                update_ctx(_ctx, _rt, dt);
+                auto ce = hrc::now();
+
+                trace::_tracer.end_step();
+
+                _recorder.step(
+                    std::chrono::duration_cast<ft_dur>(ce - cb).count());
+
+                if(!_running)
+                {
+                    break;
+                }
+            }
+        }
+
+        void init()
+        {
+            init_ctx(_ctx);
+            init_loops();
+        }
+
+    public:
+        headless_app(TContext& ctx) noexcept : _ctx{ctx}
+        {
+            init();
+        }
+    };
+
+    template <typename TContext>
+    void run_simulation(TContext& ctx)
+    {
+        headless_app<ECST_DECAY_DECLTYPE(ctx)> x{ctx};
+        (void)x;
+    }
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include <memory>
+#include <tuple>
+#include <vector>
+#include "./dependencies.hpp"
+
+namespace example
+{
+    namespace storage
+    {
+        // Array of fixed-size pages, allocated on demand. Growing never
+        // relocates existing elements, so references stay valid, and lookups
+        // do not perform any growth check.
+        template <typename T, sz_t TPageSize>
+        class paged_array
+        {
+            static_assert((TPageSize & (TPageSize - 1)) == 0,
+                "page size must be a power of two");
+
+        private:
+            std::vector<std::unique_ptr<T[]>> _pages;
+
+        public:
+            auto& operator[](sz_t i) noexcept
+            {
+                return _pages[i / TPageSize][i % TPageSize];
+            }
+
+            const auto& operator[](sz_t i) const noexcept
+            {
+                return _pages[i / TPageSize][i % TPageSize];
+            }
+
+            // Allocates pages until the `i`-th element exists, then returns
+            // it.
+            auto& grow_to(sz_t i)
+            {
+                while(_pages.size() <= i / TPageSize)
+                {
+                    _pages.emplace_back(std::make_unique<T[]>(TPageSize));
+                }
+
+                return (*this)[i];
+            }
+        };
+
+        // Component storage strategy storing all components of an entity
+        // interleaved (AoS) in the slot of a `paged_array`, indexed by entity
+        // ID. Unlike `contiguous_buffer`, memory is only committed for the
+        // pages that are used, whether the entity limit is fixed or dynamic.
+        template <typename TComponentTagList, sz_t TPageSize,
+            typename... TComponents>
+        class paged_buffer
+        {
+        public:
+            using component_tag_list_type = TComponentTagList;
+
+            struct metadata_type
+            {
+            };
+
+        private:
+            paged_array<std::tuple<TComponents...>, TPageSize> _slots;
+
+        public:
+            template <typename TComponentTag, typename... Ts>
+            auto& get(TComponentTag, ecst::entity_id eid,
+                const metadata_type&) noexcept
+            {
+                return std::get<ecst::mp::unwrap<TComponentTag>>(
+                    _slots[static_cast<sz_t>(eid)]);
+            }
+
+            template <typename TComponentTag, typename... Ts>
+            const auto& get(TComponentTag, ecst::entity_id eid,
+                const metadata_type&) const noexcept
+            {
+                return std::get<ecst::mp::unwrap<TComponentTag>>(
+                    _slots[static_cast<sz_t>(eid)]);
+            }
+
+            template <typename TComponentTag, typename... Ts>
+            auto& add(TComponentTag, ecst::entity_id eid, metadata_type&)
+            {
+                return std::get<ecst::mp::unwrap<TComponentTag>>(
+                    _slots.grow_to(static_cast<sz_t>(eid)));
+            }
+        };
+
+        namespace impl
+        {
+            template <sz_t TPageSize, typename TComponentTagList>
+            struct paged_buffer_for;
+
+            template <sz_t TPageSize,
+                template <typename...> class TList, typename... TTags>
+            struct paged_buffer_for<TPageSize, TList<TTags...>>
+            {
+                using type = paged_buffer<TList<TTags...>, TPageSize,
+                    ecst::mp::unwrap<TTags>...>;
+            };
+        }
+
+        // Maker of `paged_buffer` strategies, usable with
+        // `cs::make(...).storage_strategy(...)`.
+        template <sz_t TPageSize = 4096>
+        struct paged_buffer_maker
+        {
+            template <typename TSettings, typename TComponentTagList>
+            constexpr auto make_type(TSettings, TComponentTagList) const
+            {
+                using impl_type = typename impl::paged_buffer_for<TPageSize,
+                    TComponentTagList>::type;
+
+                return ecst::mp::type_c<impl_type>;
+            }
+        };
+    }
+}
@@ -0,0 +1,156 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "./dependencies.hpp"
+
+namespace example
+{
+    // Small pool of persistent worker threads executing index ranges in
+    // parallel. Meant for data-parallel phases of single-threaded systems
+    // that cannot be expressed as ECST subtasks (e.g. phases separated by
+    // barriers). They run while ECST's own workers are idle, waiting for the
+    // system to complete.
+    class parallel_for_pool
+    {
+    private:
+        using range_fn = std::function<void(sz_t, sz_t)>;
+
+        std::mutex _mutex;
+        std::condition_variable _cv_work;
+        std::condition_variable _cv_done;
+
+        // Parameters of the current `run` call.
+        const range_fn* _f{nullptr};
+        std::atomic<sz_t> _next{0};
+        sz_t _count{0};
+        sz_t _chunk{1};
+
+        sz_t _generation{0};
+        sz_t _pending_workers{0};
+        bool _stop{false};
+
+        // Declared last, as workers use all other members.
+        std::vector<std::thread> _workers;
+
+        // Claims and executes chunks until none are left.
+        void drain()
+        {
+            while(true)
+            {
+                auto begin = _next.fetch_add(_chunk);
+                if(begin >= _count)
+                {
+                    return;
+                }
+
+                (*_f)(begin, std::min(begin + _chunk, _count));
+            }
+        }
+
+        void worker_loop()
+        {
+            sz_t seen_generation = 0;
+            std::unique_lock<std::mutex> lock{_mutex};
+
+            while(true)
+            {
+                _cv_work.wait(lock, [&]
+                    {
+                        return _stop || _generation != seen_generation;
+                    });
+
+                if(_stop)
+                {
+                    return;
+                }
+
+                seen_generation = _generation;
+
+                lock.unlock();
+                drain();
+                lock.lock();
+
+                if(--_pending_workers == 0)
+                {
+                    _cv_done.notify_one();
+                }
+            }
+        }
+
+    public:
+        // Uses all hardware threads, including the calling one.
+        parallel_for_pool()
+        {
+            auto n = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+
+            _workers.reserve(n);
+            for(sz_t i = 0; i < n; ++i)
+            {
+                _workers.emplace_back([this]
+                    {
+                        worker_loop();
+                    });
+            }
+        }
+
+        ~parallel_for_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                _stop = true;
+            }
+
+            _cv_work.notify_all();
+
+            for(auto& w : _workers)
+            {
+                w.join();
+            }
+        }
+
+        // Executes `f(begin, end)` on consecutive ranges of at most `chunk`
+        // indices covering `[0, count)`, and returns when all of them are
+        // done. Ranges fitting in a single chunk run in the calling thread.
+        template <typename TF>
+        void run(sz_t count, sz_t chunk, TF&& f)
+        {
+            if(count <= chunk || _workers.empty())
+            {
+                f(sz_t(0), count);
+                return;
+            }
+
+            const range_fn erased{FWD(f)};
+
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                _f = &erased;
+                _next.store(0);
+                _count = count;
+                _chunk = chunk;
+                _pending_workers = _workers.size();
+                ++_generation;
+            }
+
+            _cv_work.notify_all();
+            drain();
+
+            std::unique_lock<std::mutex> lock{_mutex};
+            _cv_done.wait(lock, [this]
+                {
+                    return _pending_workers == 0;
+                });
+        }
+    };
+}
@@ -0,0 +1,147 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "./dependencies.hpp"
+
+namespace example
+{
+    // Double-buffered system outputs, allowing the outputs of frame `N` to be
+    // consumed while frame `N + 1` is being stepped.
+    //
+    // Outputs are never copied: at the end of a step, every system output is
+    // swapped with a buffer that has already been consumed, so the system
+    // keeps reusing allocated capacity and the consumer exclusively owns the
+    // outputs it is processing.
+    //
+    // Steps are executed by a single persistent producer thread, so that
+    // thread-local state (e.g. trace buffers) is not recreated every frame.
+    template <typename TOutput>
+    class pipelined_outputs
+    {
+    private:
+        // Outputs of the previous frame, being consumed.
+        std::vector<TOutput> _ready;
+        sz_t _ready_count{0};
+
+        // Outputs of the frame being stepped.
+        std::vector<TOutput> _pending;
+        sz_t _pending_count{0};
+
+        std::mutex _mutex;
+        std::condition_variable _cv;
+        std::function<void()> _job;
+        bool _job_done{false};
+        bool _stop{false};
+
+        // Declared last, as it uses all other members.
+        std::thread _producer;
+
+        void producer_loop()
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+
+            while(true)
+            {
+                _cv.wait(lock, [this]
+                    {
+                        return _stop || static_cast<bool>(_job);
+                    });
+
+                if(_stop)
+                {
+                    return;
+                }
+
+                auto job = std::move(_job);
+                _job = nullptr;
+
+                lock.unlock();
+                job();
+                lock.lock();
+
+                _job_done = true;
+                _cv.notify_all();
+            }
+        }
+
+    public:
+        pipelined_outputs()
+            : _producer{[this]
+                  {
+                      producer_loop();
+                  }}
+        {
+        }
+
+        ~pipelined_outputs()
+        {
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                _stop = true;
+            }
+
+            _cv.notify_all();
+            _producer.join();
+        }
+
+        // Takes ownership of `output`, leaving an empty consumed buffer in its
+        // place. Must only be called from the function passed as `f_produce`
+        // to `run`.
+        void push(TOutput& output)
+        {
+            if(_pending_count == _pending.size())
+            {
+                _pending.emplace_back();
+            }
+
+            using std::swap;
+            swap(_pending[_pending_count++], output);
+        }
+
+        // Runs `f_produce` in the producer thread while the outputs pushed
+        // during the previous call are passed to `f_consume` in the calling
+        // thread. Returns when both are done.
+        template <typename TFProduce, typename TFConsume>
+        void run(TFProduce&& f_produce, TFConsume&& f_consume)
+        {
+            _pending_count = 0;
+
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                _job = [&f_produce]
+                {
+                    f_produce();
+                };
+                _job_done = false;
+            }
+
+            _cv.notify_all();
+
+            for(sz_t i = 0; i < _ready_count; ++i)
+            {
+                f_consume(_ready[i]);
+            }
+
+            {
+                std::unique_lock<std::mutex> lock{_mutex};
+                _cv.wait(lock, [this]
+                    {
+                        return _job_done;
+                    });
+            }
+
+            std::swap(_ready, _pending);
+            std::swap(_ready_count, _pending_count);
+        }
+    };
+}
@@ -53,6 +53,7 @@ namespace example
 
                 // vec2f mpos = window().mapPixelToCoords(mposi);
 
+                trace::_tracer.begin_step();
                 update_ctx(_ctx, this->window(), dt);
 
                 window().display();
@@ -60,6 +61,11 @@ namespace example
                 auto real_dt =
                     std::chrono::duration_cast<ft_dur>(ce - cb).count();
 
+                _recorder.step(real_dt);
+
+                // Trace files are written after the step has been timed.
+                trace::_tracer.end_step();
+
                 // TODO:
                 auto fps = 1.f / real_dt * 1000.f;
 
@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include "./dependencies.hpp"
 
 #define EXAMPLE_COMPONENT_TAG(x)                              \
@@ -44,6 +45,17 @@
                 (void) x;                                     \
             }                                                 \
         }                                                     \
+        namespace trace                                       \
+        {                                                     \
+            template <>                                       \
+            struct system_name<s::x>                          \
+            {                                                 \
+                static const char* get() noexcept             \
+                {                                             \
+                    return #x;                                \
+                }                                             \
+            };                                                \
+        }                                                     \
     }                                                         \
     ECST_SPECIALIZE_SYSTEM_NAME(example::s::x)
 
@@ -68,6 +80,31 @@ namespace example
         return vec2f{rndf(min, max), rndf(min, max)};
     };
 
+    // Define `EXAMPLE_DETERMINISTIC` to make the simulations reproducible
+    // regardless of thread timing and of the threading policy: values that
+    // would be drawn from `rnd_gen` by concurrent or deferred code are derived
+    // from per-entity seeds instead, and outputs are consumed in a stable
+    // order.
+
+    // Returns a well-mixed hash of `x`, usable as the next seed of a
+    // per-entity random stream.
+    inline std::uint32_t mix_seed(std::uint32_t x) noexcept
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352dU;
+        x ^= x >> 15;
+        x *= 0x846ca68bU;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // Returns a float in `[min, max)` only depending on `seed`.
+    inline float seeded_rndf(std::uint32_t seed, float min, float max) noexcept
+    {
+        constexpr float inv_range = 1.f / (1U << 24);
+        return min + (max - min) * (mix_seed(seed) >> 8) * inv_range;
+    }
+
     template <typename T>
     ECST_ALWAYS_INLINE auto ECST_CONST_FN square(T x) noexcept
     {
@@ -107,8 +144,10 @@ namespace example
     }
 
 
+    // Executes `f` on every entity ID in `cell` (a contiguous range of IDs)
+    // that is lower than `eid`, so that every pair is visited only once.
     template <typename TCell, typename TF>
-    void for_unique_pairs(TCell& cell, ecst::entity_id eid, TF&& f)
+    void for_unique_pairs(const TCell& cell, ecst::entity_id eid, TF&& f)
     {
         for(auto eid2 : cell)
         {
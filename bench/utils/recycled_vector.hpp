@@ -0,0 +1,175 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include <algorithm>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "./dependencies.hpp"
+
+namespace example
+{
+    // Thread-safe pool of empty vectors that still own their storage.
+    template <typename T>
+    class vector_pool
+    {
+    private:
+        std::mutex _mutex;
+        std::vector<std::vector<T>> _free;
+
+    public:
+        // Returns the pooled vector with the largest capacity, or a new empty
+        // vector if the pool is empty.
+        auto acquire()
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+
+            if(_free.empty())
+            {
+                return std::vector<T>{};
+            }
+
+            auto it = std::max_element(_free.begin(), _free.end(),
+                [](const auto& a, const auto& b)
+                {
+                    return a.capacity() < b.capacity();
+                });
+
+            auto result = std::move(*it);
+            *it = std::move(_free.back());
+            _free.pop_back();
+
+            return result;
+        }
+
+        void release(std::vector<T>&& v)
+        {
+            if(v.capacity() == 0)
+            {
+                return;
+            }
+
+            v.clear();
+
+            std::lock_guard<std::mutex> lock{_mutex};
+            _free.emplace_back(std::move(v));
+        }
+    };
+
+    // Vector meant to be used as a system output type. Storage is taken from
+    // and given back to a per-type pool, so that the high-water-mark capacity
+    // of the outputs survives ECST recreating them when the number of
+    // subtasks of a system changes.
+    template <typename T>
+    class recycled_vector
+    {
+    private:
+        std::vector<T> _v;
+
+        // Never destroyed, as outputs may be released during static
+        // destruction.
+        static auto& pool()
+        {
+            static auto* p = new vector_pool<T>{};
+            return *p;
+        }
+
+    public:
+        recycled_vector() : _v{pool().acquire()}
+        {
+        }
+
+        recycled_vector(const recycled_vector& rhs) : _v{pool().acquire()}
+        {
+            _v.assign(rhs._v.begin(), rhs._v.end());
+        }
+
+        recycled_vector(recycled_vector&& rhs) noexcept
+            : _v{std::move(rhs._v)}
+        {
+        }
+
+        recycled_vector& operator=(const recycled_vector& rhs)
+        {
+            _v.assign(rhs._v.begin(), rhs._v.end());
+            return *this;
+        }
+
+        recycled_vector& operator=(recycled_vector&& rhs) noexcept
+        {
+            _v.swap(rhs._v);
+            return *this;
+        }
+
+        ~recycled_vector()
+        {
+            pool().release(std::move(_v));
+        }
+
+        friend void swap(recycled_vector& a, recycled_vector& b) noexcept
+        {
+            a._v.swap(b._v);
+        }
+
+        template <typename... Ts>
+        auto& emplace_back(Ts&&... xs)
+        {
+            _v.emplace_back(FWD(xs)...);
+            return _v.back();
+        }
+
+        void clear() noexcept
+        {
+            _v.clear();
+        }
+
+        void reserve(sz_t n)
+        {
+            _v.reserve(n);
+        }
+
+        auto size() const noexcept
+        {
+            return _v.size();
+        }
+
+        auto empty() const noexcept
+        {
+            return _v.empty();
+        }
+
+        auto data() noexcept
+        {
+            return _v.data();
+        }
+
+        auto data() const noexcept
+        {
+            return _v.data();
+        }
+
+        auto begin() noexcept
+        {
+            return _v.begin();
+        }
+
+        auto begin() const noexcept
+        {
+            return _v.begin();
+        }
+
+        auto end() noexcept
+        {
+            return _v.end();
+        }
+
+        auto end() const noexcept
+        {
+            return _v.end();
+        }
+    };
+}
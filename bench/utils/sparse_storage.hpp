@@ -0,0 +1,262 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "./dependencies.hpp"
+#include "./paged_storage.hpp"
+
+// Component storage strategies for sparse components, carried by a small
+// fraction of the entities. Components are never removed by ECST: when an
+// entity ID is reused, its previous slot is reused as well.
+
+namespace example
+{
+    namespace storage
+    {
+        // Open-addressing hash table with linear probing, storing the
+        // components of an entity interleaved (AoS) in a flat array. Every
+        // slot has a control byte, which is either `empty` or the 7 lowest
+        // bits of the hash of its entity ID, so that most probed slots are
+        // rejected without reading their key.
+        //
+        // Unlike `hash_map`, no node is allocated per component. Growing
+        // rehashes the table, so references obtained from `get` are only
+        // valid until the next `add`.
+        template <typename TComponentTagList, typename... TComponents>
+        class flat_hash_buffer
+        {
+        public:
+            using component_tag_list_type = TComponentTagList;
+
+            struct metadata_type
+            {
+            };
+
+        private:
+            using value_type = std::tuple<TComponents...>;
+
+            static constexpr std::uint8_t empty = 0x80;
+            static constexpr sz_t initial_capacity = 64;
+
+            std::vector<std::uint8_t> _control;
+            std::vector<ecst::entity_id> _keys;
+            std::vector<value_type> _values;
+            sz_t _size{0};
+
+            // Fibonacci hashing: entity IDs are sequential, so their bits
+            // need to be spread before masking.
+            static auto hash(ecst::entity_id eid) noexcept
+            {
+                return static_cast<std::uint64_t>(static_cast<sz_t>(eid)) *
+                       0x9e3779b97f4a7c15ULL;
+            }
+
+            static auto h1(std::uint64_t h) noexcept
+            {
+                return static_cast<sz_t>(h >> 32);
+            }
+
+            static auto h2(std::uint64_t h) noexcept
+            {
+                return static_cast<std::uint8_t>(h & 0x7f);
+            }
+
+            auto mask() const noexcept
+            {
+                return _control.size() - 1;
+            }
+
+            // Returns the slot of `eid`, or the empty slot where it would be
+            // inserted.
+            auto find_slot(ecst::entity_id eid) const noexcept
+            {
+                const auto h = hash(eid);
+                const auto tag = h2(h);
+
+                for(auto i = h1(h) & mask();; i = (i + 1) & mask())
+                {
+                    if(_control[i] == empty ||
+                        (_control[i] == tag && _keys[i] == eid))
+                    {
+                        return i;
+                    }
+                }
+            }
+
+            void rehash(sz_t capacity)
+            {
+                auto old_control = std::move(_control);
+                auto old_keys = std::move(_keys);
+                auto old_values = std::move(_values);
+
+                _control.assign(capacity, std::uint8_t(empty));
+                _keys.resize(capacity);
+                _values.resize(capacity);
+
+                for(sz_t i = 0; i < old_control.size(); ++i)
+                {
+                    if(old_control[i] == empty)
+                    {
+                        continue;
+                    }
+
+                    auto slot = find_slot(old_keys[i]);
+                    _control[slot] = old_control[i];
+                    _keys[slot] = old_keys[i];
+                    _values[slot] = std::move(old_values[i]);
+                }
+            }
+
+        public:
+            template <typename TComponentTag, typename... Ts>
+            auto& get(TComponentTag, ecst::entity_id eid,
+                const metadata_type&) noexcept
+            {
+                return std::get<ecst::mp::unwrap<TComponentTag>>(
+                    _values[find_slot(eid)]);
+            }
+
+            template <typename TComponentTag, typename... Ts>
+            const auto& get(TComponentTag, ecst::entity_id eid,
+                const metadata_type&) const noexcept
+            {
+                return std::get<ecst::mp::unwrap<TComponentTag>>(
+                    _values[find_slot(eid)]);
+            }
+
+            template <typename TComponentTag, typename... Ts>
+            auto& add(TComponentTag, ecst::entity_id eid, metadata_type&)
+            {
+                // Keep the load factor below 7/8.
+                if((_size + 1) * 8 > _control.size() * 7)
+                {
+                    auto capacity = std::max(
+                        sz_t(initial_capacity), _control.size() * 2);
+
+                    rehash(capacity);
+                }
+
+                auto slot = find_slot(eid);
+                if(_control[slot] == empty)
+                {
+                    _control[slot] = h2(hash(eid));
+                    _keys[slot] = eid;
+                    ++_size;
+                }
+
+                return std::get<ecst::mp::unwrap<TComponentTag>>(
+                    _values[slot]);
+            }
+        };
+
+        // Sparse set with a paged sparse array (entity ID to dense index) and
+        // a dense array of components, stored interleaved (AoS). Components
+        // are packed in insertion order, so the components of entities
+        // created together are adjacent, and memory for the sparse array is
+        // only committed for the pages in use. Both arrays are paged, so
+        // references stay stable.
+        template <typename TComponentTagList, typename... TComponents>
+        class sparse_set_buffer
+        {
+        public:
+            using component_tag_list_type = TComponentTagList;
+
+            struct metadata_type
+            {
+            };
+
+        private:
+            static constexpr sz_t page_size = 4096;
+
+            using value_type = std::tuple<TComponents...>;
+            using index_type = std::uint32_t;
+
+            paged_array<index_type, page_size> _sparse;
+            paged_array<ecst::entity_id, page_size> _dense_ids;
+            paged_array<value_type, page_size> _dense;
+            sz_t _size{0};
+
+            // Returns whether `eid` has a slot in the dense array. Pages of
+            // the sparse array must exist up to `eid`.
+            auto contains(ecst::entity_id eid) const noexcept
+            {
+                auto i = _sparse[static_cast<sz_t>(eid)];
+                return i < _size && _dense_ids[i] == eid;
+            }
+
+        public:
+            template <typename TComponentTag, typename... Ts>
+            auto& get(TComponentTag, ecst::entity_id eid,
+                const metadata_type&) noexcept
+            {
+                return std::get<ecst::mp::unwrap<TComponentTag>>(
+                    _dense[_sparse[static_cast<sz_t>(eid)]]);
+            }
+
+            template <typename TComponentTag, typename... Ts>
+            const auto& get(TComponentTag, ecst::entity_id eid,
+                const metadata_type&) const noexcept
+            {
+                return std::get<ecst::mp::unwrap<TComponentTag>>(
+                    _dense[_sparse[static_cast<sz_t>(eid)]]);
+            }
+
+            template <typename TComponentTag, typename... Ts>
+            auto& add(TComponentTag, ecst::entity_id eid, metadata_type&)
+            {
+                auto& i = _sparse.grow_to(static_cast<sz_t>(eid));
+
+                if(!contains(eid))
+                {
+                    i = static_cast<index_type>(_size);
+                    _dense_ids.grow_to(_size) = eid;
+                    _dense.grow_to(_size);
+                    ++_size;
+                }
+
+                return std::get<ecst::mp::unwrap<TComponentTag>>(_dense[i]);
+            }
+        };
+
+        namespace impl
+        {
+            template <template <typename, typename...> class TStrategy,
+                typename TComponentTagList>
+            struct strategy_for;
+
+            template <template <typename, typename...> class TStrategy,
+                template <typename...> class TList, typename... TTags>
+            struct strategy_for<TStrategy, TList<TTags...>>
+            {
+                using type =
+                    TStrategy<TList<TTags...>, ecst::mp::unwrap<TTags>...>;
+            };
+
+            template <template <typename, typename...> class TStrategy>
+            struct strategy_maker
+            {
+                template <typename TSettings, typename TComponentTagList>
+                constexpr auto make_type(TSettings, TComponentTagList) const
+                {
+                    using impl_type = typename strategy_for<TStrategy,
+                        TComponentTagList>::type;
+
+                    return ecst::mp::type_c<impl_type>;
+                }
+            };
+        }
+
+        // Makers usable with `cs::make(...).storage_strategy(...)`.
+        using flat_hash_buffer_maker = impl::strategy_maker<flat_hash_buffer>;
+        using sparse_set_buffer_maker =
+            impl::strategy_maker<sparse_set_buffer>;
+    }
+}
@@ -0,0 +1,259 @@
+// Copyright (c) 2015-2016 Vittorio Romeo
+// License: Academic Free License ("AFL") v. 3.0
+// AFL License page: http://opensource.org/licenses/AFL-3.0
+// http://vittorioromeo.info | vittorio.romeo@outlook.com
+
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <vrm/core/type_aliases.hpp>
+
+// Define `EXAMPLE_TRACE` to record per-system and per-subtask timings and dump
+// them every `EXAMPLE_TRACE_INTERVAL` steps as Chrome trace JSON files
+// (`trace_<step>.json`), which can be opened with `chrome://tracing` or
+// Perfetto. When `EXAMPLE_TRACE` is not defined, all tracing code compiles to
+// nothing.
+#ifndef EXAMPLE_TRACE_INTERVAL
+#define EXAMPLE_TRACE_INTERVAL 100
+#endif
+
+namespace example
+{
+    namespace trace
+    {
+        using vrm::core::sz_t;
+
+        // Name of a system, shown in traces. Specialized for every system by
+        // `EXAMPLE_SYSTEM_TAG`, and partially specializable for systems
+        // defined as templates.
+        template <typename TSystem>
+        struct system_name
+        {
+            static const char* get() noexcept
+            {
+                return "system";
+            }
+        };
+
+#ifdef EXAMPLE_TRACE
+        using clock = std::chrono::high_resolution_clock;
+        using time_point = clock::time_point;
+
+        // A completed timed region. `_entities` is the number of entities
+        // processed in the region, if meaningful.
+        struct event
+        {
+            const char* _name;
+            const char* _category;
+            time_point _start, _end;
+            sz_t _entities;
+        };
+
+        // Events recorded by a single thread. Every thread writes only to its
+        // own buffer, so recording does not need synchronization.
+        struct thread_buffer
+        {
+            sz_t _tid;
+            std::vector<event> _events;
+        };
+
+        class tracer
+        {
+        private:
+            std::mutex _mutex;
+            std::vector<std::unique_ptr<thread_buffer>> _buffers;
+            time_point _step_start{clock::now()};
+            sz_t _step{0};
+
+            auto& local_buffer()
+            {
+                thread_local thread_buffer* buffer = nullptr;
+
+                if(buffer == nullptr)
+                {
+                    std::lock_guard<std::mutex> lock{_mutex};
+
+                    _buffers.emplace_back(std::make_unique<thread_buffer>());
+                    _buffers.back()->_tid = _buffers.size() - 1;
+                    buffer = _buffers.back().get();
+                }
+
+                return *buffer;
+            }
+
+            auto to_us(const time_point& x) const noexcept
+            {
+                using us = std::chrono::duration<double, std::micro>;
+                return std::chrono::duration_cast<us>(x - _step_start).count();
+            }
+
+        public:
+            void record(const char* name, const char* category,
+                const time_point& start, const time_point& end,
+                sz_t entities = 0)
+            {
+                local_buffer()._events.emplace_back(
+                    event{name, category, start, end, entities});
+            }
+
+            void begin_step() noexcept
+            {
+                _step_start = clock::now();
+            }
+
+            // Dumps the step if required, then clears all buffers. Must not be
+            // called while systems are running.
+            void end_step()
+            {
+                if(_step % EXAMPLE_TRACE_INTERVAL == 0)
+                {
+                    std::ofstream os{
+                        "trace_" + std::to_string(_step) + ".json"};
+
+                    write_json(os);
+                }
+
+                for(auto& b : _buffers)
+                {
+                    b->_events.clear();
+                }
+
+                ++_step;
+            }
+
+            // Writes the events of the current step in Chrome trace format.
+            void write_json(std::ostream& os) const
+            {
+                bool first = true;
+                os << "{\"traceEvents\": [\n";
+
+                for(const auto& b : _buffers)
+                {
+                    for(const auto& e : b->_events)
+                    {
+                        os << (first ? "" : ",\n") << "  {\"name\": \""
+                           << e._name << "\", \"cat\": \"" << e._category
+                           << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": "
+                           << b->_tid << ", \"ts\": " << to_us(e._start)
+                           << ", \"dur\": " << to_us(e._end) - to_us(e._start)
+                           << ", \"args\": {\"entities\": " << e._entities
+                           << "}}";
+
+                        first = false;
+                    }
+                }
+
+                os << "\n]}\n";
+            }
+        };
+
+        tracer _tracer;
+
+        // Records the region between its construction and its destruction.
+        class span
+        {
+        private:
+            const char* _name;
+            const char* _category;
+            sz_t _entities;
+            time_point _start;
+
+        public:
+            span(const char* name, const char* category,
+                sz_t entities = 0) noexcept
+                : _name{name},
+                  _category{category},
+                  _entities{entities},
+                  _start{clock::now()}
+            {
+            }
+
+            ~span()
+            {
+                _tracer.record(
+                    _name, _category, _start, clock::now(), _entities);
+            }
+        };
+
+        // Wraps a `(system, data)` subtask function into a function suitable
+        // for `detailed_instance`, tracing the whole system execution and
+        // every one of its subtasks, along with the number of entities each
+        // subtask processed. The time the calling thread spends waiting for
+        // other subtasks after finishing its own is traced as "wait".
+        template <typename TF>
+        auto instance(TF&& f)
+        {
+            return [f = std::forward<TF>(f)](auto& i, auto& executor)
+            {
+                using system_type = std::decay_t<decltype(i.system())>;
+                const auto name = system_name<system_type>::get();
+
+                span sys{name, "system"};
+
+                const auto caller = std::this_thread::get_id();
+                auto caller_end = clock::now();
+
+                executor.for_subtasks([&](auto& data)
+                    {
+                        {
+                            span sub{name, "subtask",
+                                static_cast<sz_t>(data.entity_count())};
+
+                            f(i.system(), data);
+                        }
+
+                        if(std::this_thread::get_id() == caller)
+                        {
+                            caller_end = clock::now();
+                        }
+                    });
+
+                _tracer.record(name, "wait", caller_end, clock::now());
+            };
+        }
+#else
+        class tracer
+        {
+        public:
+            void begin_step() noexcept
+            {
+            }
+
+            void end_step() noexcept
+            {
+            }
+        };
+
+        tracer _tracer;
+
+        class span
+        {
+        public:
+            span(const char*, const char*, sz_t = 0) noexcept
+            {
+            }
+        };
+
+        template <typename TF>
+        auto instance(TF&& f)
+        {
+            return [f = std::forward<TF>(f)](auto& i, auto& executor)
+            {
+                executor.for_subtasks([&](auto& data)
+                    {
+                        f(i.system(), data);
+                    });
+            };
+        }
+#endif
+    }
+}